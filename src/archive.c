@@ -0,0 +1,467 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "archive.h"
+#include "fen.h"
+#include "pgn.h"
+
+/* After the header, each game is a record of its size in 4 bytes, then:
+ *   the initial position as a FEN string, empty for the standard one
+ *   the number of tags, then each tag's name and value
+ *   the moves, 16 bits each, with markers between them in PGN's order
+ * Numbers are little endian, and counts and string sizes are varints. */
+
+static const char ARCHIVE_HEADER[8] = { 'C', 'H', 'S', 'A', 1, 0, 0, 0 };
+
+/* Moves only use the low 15 bits */
+#define ARCHIVE_MARKER 0x8000
+#define ARCHIVE_END (ARCHIVE_MARKER | 0)
+#define ARCHIVE_VARIATION_START (ARCHIVE_MARKER | 1)
+#define ARCHIVE_VARIATION_END (ARCHIVE_MARKER | 2)
+#define ARCHIVE_COMMENT (ARCHIVE_MARKER | 3)
+#define ARCHIVE_NAG (ARCHIVE_MARKER | 0x100) /* with the NAG in the low byte */
+
+static void put_u16(ChessBuffer* buffer, unsigned int value)
+{
+    chess_buffer_append_char(buffer, (char)(value & 0xff));
+    chess_buffer_append_char(buffer, (char)((value >> 8) & 0xff));
+}
+
+static void put_varint(ChessBuffer* buffer, size_t value)
+{
+    while (value >= 0x80)
+    {
+        chess_buffer_append_char(buffer, (char)(value | 0x80));
+        value >>= 7;
+    }
+    chess_buffer_append_char(buffer, (char)value);
+}
+
+static void put_string(ChessBuffer* buffer, const char* s, size_t size)
+{
+    put_varint(buffer, size);
+    chess_buffer_append_string_size(buffer, s, size);
+}
+
+static void put_move(ChessBuffer* buffer, ChessMove move)
+{
+    assert((move & ~0x7fff) == 0);
+    put_u16(buffer, move);
+}
+
+static void encode_notes(const ChessVariation* variation, ChessBuffer* buffer)
+{
+    ChessAnnotation annotations[4];
+    size_t n = chess_variation_annotations(variation, annotations), i;
+
+    for (i = 0; i < n; i++)
+        put_u16(buffer, ARCHIVE_NAG | annotations[i]);
+
+    if (variation->comment.size > 0)
+    {
+        put_u16(buffer, ARCHIVE_COMMENT);
+        put_string(buffer, variation->comment.data, variation->comment.size);
+    }
+}
+
+static void encode_variation(const ChessVariation* variation, ChessBuffer* buffer)
+{
+    const ChessVariation* alternate;
+
+    do
+    {
+        put_move(buffer, variation->move);
+        encode_notes(variation, buffer);
+
+        /* Alternatives follow the first move, as in PGN */
+        if (variation->left == NULL)
+        {
+            for (alternate = variation->right; alternate != NULL; alternate = alternate->right)
+            {
+                put_u16(buffer, ARCHIVE_VARIATION_START);
+                encode_variation(alternate, buffer);
+                put_u16(buffer, ARCHIVE_VARIATION_END);
+            }
+        }
+    } while ((variation = variation->first_child) != NULL);
+}
+
+static void encode_game(const ChessGame* game, ChessBuffer* buffer)
+{
+    ChessGameTagIterator iter = chess_game_get_tag_iterator((ChessGame*)game);
+    const ChessVariation* root;
+    char fen[CHESS_FEN_MAX_LENGTH];
+    const char* value;
+    size_t num_tags = 0, ply, i;
+
+    chess_fen_save(chess_game_initial_position(game), fen);
+    if (strcmp(fen, CHESS_FEN_STARTING_POSITION) == 0)
+        put_varint(buffer, 0);
+    else
+        put_string(buffer, fen, strlen(fen));
+
+    /* Empty tags are left out, so they're counted first */
+    while (chess_game_tag_iterator_next(&iter))
+        num_tags += (*chess_game_tag_iterator_value(&iter) != '\0');
+    put_varint(buffer, num_tags);
+    iter = chess_game_get_tag_iterator((ChessGame*)game);
+    while (chess_game_tag_iterator_next(&iter))
+    {
+        value = chess_game_tag_iterator_value(&iter);
+        if (*value == '\0')
+            continue;
+        value = chess_game_tag_iterator_name(&iter);
+        put_string(buffer, value, strlen(value));
+        value = chess_game_tag_iterator_value(&iter);
+        put_string(buffer, value, strlen(value));
+    }
+
+    if (chess_game_is_compact(game))
+    {
+        ply = chess_game_ply(game);
+        for (i = 0; i < ply; i++)
+            put_move(buffer, chess_game_move_at_ply(game, i));
+    }
+    else
+    {
+        root = chess_game_tree(game);
+        encode_notes(root, buffer);
+        if (root->first_child != NULL)
+            encode_variation(root->first_child, buffer);
+    }
+    put_u16(buffer, ARCHIVE_END);
+}
+
+static void write_record(ChessBuffer* record, ChessWriter* writer)
+{
+    size_t size = chess_buffer_size(record);
+    char prefix[4];
+
+    prefix[0] = (char)(size & 0xff);
+    prefix[1] = (char)((size >> 8) & 0xff);
+    prefix[2] = (char)((size >> 16) & 0xff);
+    prefix[3] = (char)((size >> 24) & 0xff);
+    chess_writer_write_string_size(writer, prefix, 4);
+    chess_writer_write_string_size(writer, chess_buffer_data(record), size);
+}
+
+void chess_archive_save_header(ChessWriter* writer)
+{
+    chess_writer_write_string_size(writer, ARCHIVE_HEADER, sizeof(ARCHIVE_HEADER));
+}
+
+void chess_archive_save(const ChessGame* game, ChessWriter* writer)
+{
+    ChessBuffer record;
+
+    chess_buffer_init(&record);
+    encode_game(game, &record);
+    write_record(&record, writer);
+    chess_buffer_cleanup(&record);
+}
+
+typedef struct
+{
+    const unsigned char* p;
+    const unsigned char* end;
+} ArchiveInput;
+
+static ChessBoolean get_u16(ArchiveInput* in, unsigned int* value)
+{
+    if (in->end - in->p < 2)
+        return CHESS_FALSE;
+
+    *value = in->p[0] | (in->p[1] << 8);
+    in->p += 2;
+    return CHESS_TRUE;
+}
+
+static ChessBoolean get_varint(ArchiveInput* in, size_t* value)
+{
+    unsigned int shift = 0;
+
+    *value = 0;
+    while (in->p < in->end && shift < 8 * sizeof(size_t))
+    {
+        *value |= (size_t)(*in->p & 0x7f) << shift;
+        if ((*in->p++ & 0x80) == 0)
+            return CHESS_TRUE;
+        shift += 7;
+    }
+    return CHESS_FALSE;
+}
+
+static ChessBoolean get_string(ArchiveInput* in, const char** s, size_t* size)
+{
+    if (!get_varint(in, size) || *size > (size_t)(in->end - in->p))
+        return CHESS_FALSE;
+
+    *s = (const char*)in->p;
+    in->p += *size;
+    return CHESS_TRUE;
+}
+
+/* The last move of a compact mainline, once it's made into a tree */
+static ChessVariation* last_mainline_node(ChessGame* game)
+{
+    ChessVariation* root = chess_game_root_variation(game);
+    size_t ply = chess_game_ply(game);
+    return (ply > 0) ? chess_variation_ply(root, ply - 1) : root;
+}
+
+/* As with PGN, moves go into the variation under root, or if that's NULL,
+ * onto the end of the game's compact mainline. Moves are played from the
+ * initial position, and one that isn't legal there makes the record
+ * corrupt. If the position is NULL, only the promotion is checked, enough
+ * to keep the move in range. Stops at the marker that ends the variation,
+ * which is returned in end. */
+static ChessBoolean decode_variation(ArchiveInput* in, ChessGame* game,
+    const ChessPosition* initial_position, ChessVariation* root, unsigned int* end)
+{
+    ChessVariation* variation = root;
+    ChessBoolean moved = CHESS_FALSE;
+    ChessPosition position;
+    ChessMove move = 0;
+    ChessUnmove unmove = 0;
+    unsigned int value, sub_end;
+    const char* comment;
+    size_t size;
+
+    if (initial_position)
+        chess_position_copy(initial_position, &position);
+    for (;;)
+    {
+        if (!get_u16(in, &value))
+            return CHESS_FALSE;
+
+        if ((value & ARCHIVE_MARKER) == 0)
+        {
+            move = value;
+            if (initial_position == NULL)
+            {
+                if (chess_move_promotes(move) > CHESS_MOVE_PROMOTE_QUEEN)
+                    return CHESS_FALSE;
+            }
+            else
+            {
+                if (!chess_position_move_is_legal(&position, move))
+                    return CHESS_FALSE;
+                unmove = chess_position_make_move(&position, move);
+            }
+
+            if (variation)
+                variation = chess_variation_add_child(variation, move);
+            else
+                chess_game_append_move(game, move);
+            moved = CHESS_TRUE;
+            continue;
+        }
+
+        if ((value & 0xff00) == ARCHIVE_NAG)
+        {
+            if (!moved || (value & 0xff) == 0)
+                return CHESS_FALSE;
+
+            if (variation == NULL)
+                variation = last_mainline_node(game);
+            chess_variation_add_annotation(variation, value & 0xff);
+            continue;
+        }
+
+        switch (value)
+        {
+            case ARCHIVE_COMMENT:
+                if (!get_string(in, &comment, &size))
+                    return CHESS_FALSE;
+
+                if (variation == NULL)
+                    variation = last_mainline_node(game);
+                chess_variation_set_comment(variation, comment, size);
+                break;
+            case ARCHIVE_VARIATION_START:
+                if (!moved)
+                    return CHESS_FALSE;
+
+                if (variation == NULL)
+                    variation = last_mainline_node(game);
+
+                /* Alternatives to the last move start from before it */
+                if (initial_position)
+                    chess_position_undo_move(&position, unmove);
+                if (!decode_variation(in, game, initial_position ? &position : NULL,
+                        variation->parent, &sub_end)
+                    || sub_end != ARCHIVE_VARIATION_END)
+                    return CHESS_FALSE;
+                if (initial_position)
+                    chess_position_make_move(&position, move);
+                break;
+            case ARCHIVE_END:
+            case ARCHIVE_VARIATION_END:
+                *end = value;
+                return CHESS_TRUE;
+            default:
+                return CHESS_FALSE;
+        }
+    }
+}
+
+static ChessArchiveLoadResult decode_game(ChessArchiveLoader* loader,
+    const char* data, size_t size, ChessGame* game)
+{
+    ArchiveInput in;
+    ChessPosition position;
+    char fen[CHESS_FEN_MAX_LENGTH];
+    const char* s, *name, *value;
+    size_t length, num_tags, name_size, value_size, i;
+    unsigned int end;
+
+    in.p = (const unsigned char*)data;
+    in.end = in.p + size;
+
+    if (!get_string(&in, &s, &length) || length >= sizeof(fen))
+        return CHESS_ARCHIVE_LOAD_CORRUPT;
+    if (length > 0)
+    {
+        memcpy(fen, s, length);
+        fen[length] = '\0';
+        if (!chess_fen_load(fen, &position))
+            return CHESS_ARCHIVE_LOAD_CORRUPT;
+        chess_game_reset_position(game, &position);
+    }
+    else
+    {
+        chess_game_reset(game);
+    }
+
+    if (!get_varint(&in, &num_tags))
+        return CHESS_ARCHIVE_LOAD_CORRUPT;
+    for (i = 0; i < num_tags; i++)
+    {
+        if (!get_string(&in, &name, &name_size) || !get_string(&in, &value, &value_size))
+            return CHESS_ARCHIVE_LOAD_CORRUPT;
+
+        /* The game wants them null terminated */
+        chess_buffer_clear(&loader->text);
+        chess_buffer_append_string_size(&loader->text, name, name_size);
+        chess_buffer_append_char(&loader->text, '\0');
+        chess_buffer_append_string_size(&loader->text, value, value_size);
+        chess_buffer_append_char(&loader->text, '\0');
+        s = chess_buffer_data(&loader->text);
+        chess_game_set_tag(game, s, s + name_size + 1);
+    }
+
+    if (!decode_variation(&in, game, loader->trusted ? NULL : chess_game_initial_position(game),
+            NULL, &end)
+        || end != ARCHIVE_END || in.p != in.end)
+        return CHESS_ARCHIVE_LOAD_CORRUPT;
+
+    return CHESS_ARCHIVE_LOAD_OK;
+}
+
+void chess_archive_loader_init(ChessArchiveLoader* loader, ChessReader* reader)
+{
+    loader->reader = reader;
+    loader->started = CHESS_FALSE;
+    loader->trusted = CHESS_FALSE;
+    chess_buffer_init(&loader->record);
+    chess_buffer_init(&loader->text);
+}
+
+void chess_archive_loader_set_trusted(ChessArchiveLoader* loader, ChessBoolean trusted)
+{
+    loader->trusted = trusted;
+}
+
+void chess_archive_loader_cleanup(ChessArchiveLoader* loader)
+{
+    chess_buffer_cleanup(&loader->record);
+    chess_buffer_cleanup(&loader->text);
+}
+
+/* Returns how many bytes could be read, up to size */
+static size_t read_bytes(ChessReader* reader, char* data, size_t size)
+{
+    size_t n;
+    int c;
+
+    for (n = 0; n < size && (c = chess_reader_getc(reader)) != EOF; n++)
+        data[n] = (char)c;
+    return n;
+}
+
+ChessArchiveLoadResult chess_archive_loader_next(ChessArchiveLoader* loader, ChessGame* game)
+{
+    char prefix[sizeof(ARCHIVE_HEADER)];
+    const char* data;
+    size_t n, size;
+    ChessArchiveLoadResult result;
+
+    if (!loader->started)
+    {
+        n = read_bytes(loader->reader, prefix, sizeof(ARCHIVE_HEADER));
+        if (n == 0)
+            return CHESS_ARCHIVE_LOAD_EOF;
+        if (n < sizeof(ARCHIVE_HEADER) || memcmp(prefix, ARCHIVE_HEADER, sizeof(ARCHIVE_HEADER)) != 0)
+            return CHESS_ARCHIVE_LOAD_BAD_HEADER;
+        loader->started = CHESS_TRUE;
+    }
+
+    n = read_bytes(loader->reader, prefix, 4);
+    if (n == 0)
+        return CHESS_ARCHIVE_LOAD_EOF;
+    size = (size_t)(unsigned char)prefix[0]
+        | ((size_t)(unsigned char)prefix[1] << 8)
+        | ((size_t)(unsigned char)prefix[2] << 16)
+        | ((size_t)(unsigned char)prefix[3] << 24);
+    if (n < 4 || size == 0)
+        return CHESS_ARCHIVE_LOAD_CORRUPT;
+
+    /* Decode straight from the reader's memory if it will lend it */
+    if (chess_reader_span(loader->reader, &data) >= size && data != NULL)
+    {
+        result = decode_game(loader, data, size, game);
+        chess_reader_skip(loader->reader, size);
+        return result;
+    }
+
+    chess_buffer_set_size(&loader->record, size);
+    n = read_bytes(loader->reader, chess_buffer_data(&loader->record), size);
+    if (n < size)
+        return CHESS_ARCHIVE_LOAD_CORRUPT;
+    return decode_game(loader, chess_buffer_data(&loader->record), size, game);
+}
+
+size_t chess_archive_convert_pgn(ChessReader* pgn, ChessWriter* archive, size_t* skipped)
+{
+    ChessPgnLoader loader;
+    ChessPgnLoadResult result;
+    ChessGame* game = chess_game_new();
+    ChessBuffer record;
+    size_t written = 0;
+
+    if (skipped != NULL)
+        *skipped = 0;
+
+    chess_buffer_init(&record);
+    chess_pgn_loader_init(&loader, pgn);
+    chess_archive_save_header(archive);
+    while ((result = chess_pgn_loader_next(&loader, game)) != CHESS_PGN_LOAD_EOF)
+    {
+        if (result != CHESS_PGN_LOAD_OK)
+        {
+            if (skipped != NULL)
+                (*skipped)++;
+            continue;
+        }
+
+        chess_buffer_clear(&record);
+        encode_game(game, &record);
+        write_record(&record, archive);
+        written++;
+    }
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_cleanup(&record);
+    chess_game_destroy(game);
+    return written;
+}
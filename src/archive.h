@@ -0,0 +1,50 @@
+#ifndef CHESSLIB_ARCHIVE_H_
+#define CHESSLIB_ARCHIVE_H_
+
+#include "cbuffer.h"
+#include "game.h"
+#include "reader.h"
+#include "writer.h"
+
+/* A binary alternative to PGN that loads without parsing moves, only
+ * checking that each is legal. An archive is a short header followed by one
+ * record per game, holding its initial position, tags and moves (with
+ * variations, comments and annotations). Moves take 16 bits each. */
+
+typedef enum {
+    CHESS_ARCHIVE_LOAD_OK = 0,
+    CHESS_ARCHIVE_LOAD_BAD_HEADER,
+    CHESS_ARCHIVE_LOAD_CORRUPT,
+    CHESS_ARCHIVE_LOAD_EOF
+} ChessArchiveLoadResult;
+
+void chess_archive_save_header(ChessWriter*);
+void chess_archive_save(const ChessGame*, ChessWriter*);
+
+typedef struct
+{
+    ChessReader* reader;
+    ChessBoolean started;
+    ChessBoolean trusted;
+    ChessBuffer record; /* for readers that don't lend memory */
+    ChessBuffer text;
+} ChessArchiveLoader;
+
+void chess_archive_loader_init(ChessArchiveLoader*, ChessReader*);
+void chess_archive_loader_cleanup(ChessArchiveLoader*);
+
+/* When on, moves are loaded without checking they're legal, which takes
+ * about a third of the time. Only for archives that can be trusted, such
+ * as those this library wrote: a record with an illegal move then loads
+ * as if it were fine, and saving or playing through the game is undefined. */
+void chess_archive_loader_set_trusted(ChessArchiveLoader*, ChessBoolean);
+
+/* After a corrupt record the loader carries on with the next one */
+ChessArchiveLoadResult chess_archive_loader_next(ChessArchiveLoader*, ChessGame*);
+
+/* Writes an archive of all the games in a PGN file. Returns the number of
+ * games written, and counts those that couldn't be loaded in skipped (if
+ * not NULL). */
+size_t chess_archive_convert_pgn(ChessReader* pgn, ChessWriter* archive, size_t* skipped);
+
+#endif /* CHESSLIB_ARCHIVE_H_ */
@@ -0,0 +1,73 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../fen.h"
+#include "../generate.h"
+
+static const char* positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "R6R/3Q4/1Q4Q1/4Q3/2Q4Q/Q4Q2/pp1Q4/kBNN1KB1 w - - 0 1",
+};
+
+static double seconds_since(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Times bulk generation and the move iterator over the same positions */
+int main(int argc, const char* argv[])
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 200000;
+    ChessPosition position;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    ChessMoveGenerator generator;
+    unsigned long total_moves, total_calls;
+    double bulk_time = 0, iter_time = 0, bulk_elapsed, iter_elapsed;
+    clock_t start;
+    size_t p;
+    long i;
+
+    chess_generate_init();
+
+    printf("%-8s %6s %12s %12s\n", "position", "moves", "bulk ns", "iterator ns");
+    for (p = 0; p < sizeof(positions) / sizeof(positions[0]); p++)
+    {
+        chess_fen_load(positions[p], &position);
+
+        total_moves = 0;
+        start = clock();
+        for (i = 0; i < iterations; i++)
+            total_moves += chess_generate_moves(&position, moves);
+        bulk_elapsed = seconds_since(start);
+        bulk_time += bulk_elapsed;
+
+        total_calls = 0;
+        start = clock();
+        for (i = 0; i < iterations; i++)
+        {
+            chess_move_generator_init(&generator, &position);
+            while (chess_move_generator_next(&generator))
+                total_calls++;
+        }
+        iter_elapsed = seconds_since(start);
+        iter_time += iter_elapsed;
+
+        printf("%-8lu %6lu %12.1f %12.1f\n", (unsigned long)p + 1, total_moves / iterations,
+            bulk_elapsed * 1e9 / iterations, iter_elapsed * 1e9 / iterations);
+
+        if (total_calls != total_moves)
+        {
+            fprintf(stderr, "Iterator returned %lu moves, expected %lu\n", total_calls, total_moves);
+            return 1;
+        }
+    }
+
+    printf("Total: bulk %.3fs, iterator %.3fs\n", bulk_time, iter_time);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <assert.h>
+
+#include "bitboard.h"
+
+ChessSquare chess_bitboard_lsb(ChessBitboard bb)
+{
+    ChessSquare sq = CHESS_SQUARE_A1;
+    assert(bb != CHESS_BITBOARD_EMPTY);
+    while ((bb & 1) == 0)
+    {
+        bb >>= 1;
+        sq++;
+    }
+    return sq;
+}
+
+ChessSquare chess_bitboard_msb(ChessBitboard bb)
+{
+    ChessSquare sq = CHESS_SQUARE_A1;
+    assert(bb != CHESS_BITBOARD_EMPTY);
+    while ((bb >>= 1) != 0)
+        sq++;
+    return sq;
+}
+
+int chess_bitboard_count(ChessBitboard bb)
+{
+    int count = 0;
+    while (bb)
+    {
+        bb &= bb - 1;
+        count++;
+    }
+    return count;
+}
+
+ChessSquare chess_bitboard_pop(ChessBitboard* bb)
+{
+    ChessSquare sq = CHESS_BITBOARD_LSB(*bb);
+    *bb &= *bb - 1;
+    return sq;
+}
@@ -0,0 +1,35 @@
+#ifndef CHESSLIB_BITBOARD_H_
+#define CHESSLIB_BITBOARD_H_
+
+#include <stdint.h>
+
+#include "chess.h"
+
+/* A set of squares, with bit n set when square n is a member */
+typedef uint64_t ChessBitboard;
+
+#define CHESS_BITBOARD_EMPTY ((ChessBitboard)0)
+#define CHESS_BITBOARD_FULL (~(ChessBitboard)0)
+#define CHESS_BITBOARD_SQUARE(sq) ((ChessBitboard)1 << (sq))
+
+/* The hot paths use the compiler intrinsics where they are available */
+#if defined(__GNUC__)
+#define CHESS_BITBOARD_LSB(bb) ((ChessSquare)__builtin_ctzll(bb))
+#define CHESS_BITBOARD_MSB(bb) ((ChessSquare)(63 - __builtin_clzll(bb)))
+#define CHESS_BITBOARD_COUNT(bb) __builtin_popcountll(bb)
+#else
+#define CHESS_BITBOARD_LSB(bb) chess_bitboard_lsb(bb)
+#define CHESS_BITBOARD_MSB(bb) chess_bitboard_msb(bb)
+#define CHESS_BITBOARD_COUNT(bb) chess_bitboard_count(bb)
+#endif
+
+/* These must not be passed an empty bitboard */
+ChessSquare chess_bitboard_lsb(ChessBitboard);
+ChessSquare chess_bitboard_msb(ChessBitboard);
+
+int chess_bitboard_count(ChessBitboard);
+
+/* Removes and returns the lowest square in the bitboard */
+ChessSquare chess_bitboard_pop(ChessBitboard*);
+
+#endif /* CHESSLIB_BITBOARD_H_ */
@@ -4,9 +4,16 @@
 
 static int alloc_count = 0;
 
+/* Games are loaded on several threads at once, so keep the count exact */
+#if defined(__GNUC__)
+#define COUNT_ADD(n) __sync_fetch_and_add(&alloc_count, (n))
+#else
+#define COUNT_ADD(n) (alloc_count += (n))
+#endif
+
 void* chess_alloc(size_t size)
 {
-    alloc_count++;
+    COUNT_ADD(1);
     return malloc(size);
 }
 
@@ -17,7 +24,7 @@ void* chess_realloc(void* ptr, size_t size)
 
 void chess_free(void* ptr)
 {
-    alloc_count--;
+    COUNT_ADD(-1);
     free(ptr);
 }
 
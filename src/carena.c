@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "carena.h"
+#include "calloc.h"
+
+#define CHESS_ARENA_BLOCK_SIZE 8192
+
+typedef union
+{
+    long l;
+    double d;
+    void* p;
+} ArenaAlign;
+
+struct ChessArenaBlock
+{
+    ChessArenaBlock* next;
+    size_t size;
+    ArenaAlign data[1];
+};
+
+static void use_block(ChessArena* arena, ChessArenaBlock* block)
+{
+    arena->current = block;
+    arena->next = (char*)block->data;
+    arena->end = arena->next + block->size;
+}
+
+static ChessArenaBlock* new_block(size_t size)
+{
+    ChessArenaBlock* block = chess_alloc(offsetof(ChessArenaBlock, data) + size);
+    block->next = NULL;
+    block->size = size;
+    return block;
+}
+
+void chess_arena_init(ChessArena* arena)
+{
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+}
+
+void chess_arena_cleanup(ChessArena* arena)
+{
+    ChessArenaBlock* block, *next;
+    for (block = arena->first; block != NULL; block = next)
+    {
+        next = block->next;
+        chess_free(block);
+    }
+}
+
+void* chess_arena_alloc(ChessArena* arena, size_t size)
+{
+    ChessArenaBlock* block;
+    void* p;
+
+    /* Round up so the next allocation is aligned too */
+    size = (size + sizeof(ArenaAlign) - 1) / sizeof(ArenaAlign) * sizeof(ArenaAlign);
+    if (size == 0)
+        size = sizeof(ArenaAlign);
+
+    if ((size_t)(arena->end - arena->next) < size)
+    {
+        if (arena->current && arena->current->next && arena->current->next->size >= size)
+        {
+            /* Left over from before a reset */
+            block = arena->current->next;
+        }
+        else
+        {
+            /* Anything bigger than a block gets one of its own */
+            block = new_block(size > CHESS_ARENA_BLOCK_SIZE ? size : CHESS_ARENA_BLOCK_SIZE);
+            if (arena->current)
+            {
+                block->next = arena->current->next;
+                arena->current->next = block;
+            }
+            else
+            {
+                assert(arena->first == NULL);
+                arena->first = block;
+            }
+        }
+        use_block(arena, block);
+    }
+
+    p = arena->next;
+    arena->next += size;
+    return p;
+}
+
+void chess_arena_reset(ChessArena* arena)
+{
+    if (arena->first)
+        use_block(arena, arena->first);
+}
@@ -0,0 +1,27 @@
+#ifndef CHESSLIB_ARENA_H_
+#define CHESSLIB_ARENA_H_
+
+#include <stddef.h>
+
+typedef struct ChessArenaBlock ChessArenaBlock;
+
+/* Hands out memory from large blocks, which is only given back all at once.
+ * Blocks are kept when the arena is reset, so a reused arena soon stops
+ * allocating. */
+typedef struct
+{
+    ChessArenaBlock* first;
+    ChessArenaBlock* current;
+    char* next, *end;
+} ChessArena;
+
+void chess_arena_init(ChessArena*);
+void chess_arena_cleanup(ChessArena*);
+
+/* Suitably aligned for any type */
+void* chess_arena_alloc(ChessArena*, size_t size);
+
+/* Frees everything allocated so far, in constant time */
+void chess_arena_reset(ChessArena*);
+
+#endif /* CHESSLIB_ARENA_H_ */
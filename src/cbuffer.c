@@ -68,7 +68,7 @@ void chess_buffer_append_string_size(ChessBuffer* buffer, const char* s, size_t
     if (buffer->size + size > buffer->max_size)
         expand(buffer, buffer->size + size);
 
-    strncpy(buffer->data + buffer->size, s, size);
+    memcpy(buffer->data + buffer->size, s, size);
     buffer->size += size;
 }
 
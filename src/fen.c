@@ -9,6 +9,33 @@
 
 const char* const CHESS_FEN_STARTING_POSITION = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+/* Splits off the next token like strtok, but keeps its place in *s rather
+ * than in a static, so FENs can be loaded on several threads at once */
+static char* next_token(char** s, char delim)
+{
+    char* token = *s, *end;
+
+    while (*token == delim)
+        token++;
+    if (*token == '\0')
+    {
+        *s = token;
+        return NULL;
+    }
+
+    end = strchr(token, delim);
+    if (end)
+    {
+        *end = '\0';
+        *s = end + 1;
+    }
+    else
+    {
+        *s = token + strlen(token);
+    }
+    return token;
+}
+
 ChessBoolean chess_fen_load(const char* s, ChessPosition* position)
 {
     ChessPosition temp_position;
@@ -16,19 +43,18 @@ ChessBoolean chess_fen_load(const char* s, ChessPosition* position)
     ChessFile file;
     ChessPiece piece;
     char s_copy[CHESS_FEN_MAX_LENGTH];
-    char *tokens[6], *token, *c;
+    char *tokens[6], *token, *c, *rest;
     int t, m, skip;
 
-    /* Clone the string, as strtok will clobber it */
+    /* Clone the string, as splitting it will clobber it */
     strncpy(s_copy, s, CHESS_FEN_MAX_LENGTH - 1);
+    s_copy[CHESS_FEN_MAX_LENGTH - 1] = '\0';
 
     t = 0;
-    token = strtok(s_copy, " ");
-    while (token && t < 6)
-    {
+    rest = s_copy;
+    tokens[0] = s_copy;
+    while (t < 6 && (token = next_token(&rest, ' ')) != NULL)
         tokens[t++] = token;
-        token = strtok(NULL, " ");
-    }
 
     /* Clear the position before filling it in */
     memset(&temp_position, 0, sizeof(ChessPosition));
@@ -37,7 +63,8 @@ ChessBoolean chess_fen_load(const char* s, ChessPosition* position)
 
     /* The first token is the board */
     rank = CHESS_RANK_8;
-    token = strtok(tokens[0], "/");
+    rest = tokens[0];
+    token = next_token(&rest, '/');
     while (token && *token && rank >= CHESS_RANK_1)
     {
         m = 0;
@@ -61,7 +88,7 @@ ChessBoolean chess_fen_load(const char* s, ChessPosition* position)
             }
             m++;
         }
-        token = strtok(NULL, "/");
+        token = next_token(&rest, '/');
         rank--;
     }
 
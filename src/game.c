@@ -5,9 +5,13 @@
 #include "fen.h"
 #include "game.h"
 #include "calloc.h"
+#include "carena.h"
 #include "cstring.h"
 #include "carray.h"
 
+/* Moves fit in 16 bits: 6 for each square and 3 for the promotion */
+typedef unsigned short PackedMove;
+
 struct ExtraTag
 {
     ChessString name;
@@ -20,6 +24,15 @@ struct ChessGame
 {
     ChessPosition initial_position;
     ChessVariation* root_variation;
+    ChessArena arena; /* everything under the root variation */
+
+    /* Until something needs the tree, a plain mainline is kept as an array
+     * of moves and the root variation has no children. After that the array
+     * caches the tree's mainline, kept up to date as the tree changes, and
+     * mainline_end is its last node. */
+    ChessBoolean compact;
+    ChessArray mainline;
+    const ChessVariation* mainline_end;
 
     /* PGN tags */
     ChessString event;
@@ -30,8 +43,16 @@ struct ChessGame
     ChessString black;
     ChessResult result;
     ExtraTag* extra;
+
+    /* Moves not read yet, see chess_game_defer_moves */
+    ChessGameMovesFunc moves_func;
+    const char* moves_text;
+    size_t moves_size;
+    ChessBoolean moves_ok;
 };
 
+static void tree_changed(ChessGame*, ChessVariation*);
+
 ChessGame* chess_game_new(void)
 {
     ChessPosition position;
@@ -45,7 +66,13 @@ ChessGame* chess_game_new_position(const ChessPosition* position)
     memset(game, 0, sizeof(ChessGame));
 
     chess_position_copy(position, &game->initial_position);
-    game->root_variation = chess_variation_new();
+    chess_arena_init(&game->arena);
+    game->root_variation = chess_variation_new_arena(&game->arena);
+    chess_variation_set_changed_func(game->root_variation,
+        (ChessVariationChangedFunc)tree_changed, game);
+    game->compact = CHESS_TRUE;
+    chess_array_init(&game->mainline, sizeof(PackedMove));
+    game->moves_ok = CHESS_TRUE;
 
     chess_string_init(&game->event);
     chess_string_init(&game->site);
@@ -67,8 +94,9 @@ ChessGame* chess_game_new_fen(const char* fen)
 static void cleanup_extra_tags(ChessGame* game)
 {
     ExtraTag* extra, *next;
-    for (next = game->extra; (extra = next) != NULL; next = extra->next)
+    for (extra = game->extra; extra != NULL; extra = next)
     {
+        next = extra->next;
         chess_string_cleanup(&extra->name);
         chess_string_cleanup(&extra->value);
         chess_free(extra);
@@ -79,6 +107,8 @@ void chess_game_destroy(ChessGame* game)
 {
     assert(game != NULL);
     chess_variation_destroy(game->root_variation);
+    chess_arena_cleanup(&game->arena);
+    chess_array_cleanup(&game->mainline);
 
     chess_string_cleanup(&game->event);
     chess_string_cleanup(&game->site);
@@ -98,10 +128,112 @@ void chess_game_reset(ChessGame* game)
     chess_game_reset_position(game, &position);
 }
 
+static void drop_deferred_moves(ChessGame* game)
+{
+    game->moves_func = NULL;
+    game->moves_ok = CHESS_TRUE;
+}
+
+static void clear_moves(ChessGame* game)
+{
+    /* The nodes are all in the arena, so there's no need to walk them */
+    chess_variation_truncate(game->root_variation);
+    chess_variation_set_comment(game->root_variation, "", 0);
+    chess_arena_reset(&game->arena);
+    chess_array_clear(&game->mainline);
+    game->compact = CHESS_TRUE;
+}
+
+static ChessMove unpack_move(PackedMove packed)
+{
+    return (ChessMove)packed;
+}
+
+static PackedMove pack_move(ChessMove move)
+{
+    assert((move & ~0x7fff) == 0);
+    return (PackedMove)move;
+}
+
+/* Caches the mainline from under the node, which is at the given ply */
+static void cache_mainline_from(ChessGame* game, const ChessVariation* variation, size_t ply)
+{
+    PackedMove packed;
+
+    chess_array_prune(&game->mainline, ply);
+    while (variation->first_child)
+    {
+        variation = variation->first_child;
+        packed = pack_move(variation->move);
+        chess_array_push(&game->mainline, &packed);
+    }
+    game->mainline_end = variation;
+}
+
+static void cache_mainline(ChessGame* game)
+{
+    cache_mainline_from(game, game->root_variation, 0);
+}
+
+/* Whether the node is on the mainline, with its ply if so */
+static ChessBoolean mainline_ply(const ChessVariation* variation, size_t* ply)
+{
+    size_t depth = 0;
+
+    for (; !chess_variation_is_root(variation); variation = variation->parent, depth++)
+    {
+        if (variation->left != NULL)
+            return CHESS_FALSE;
+    }
+    *ply = depth;
+    return CHESS_TRUE;
+}
+
+/* Called as the tree changes. Only changes under the mainline matter, and
+ * most are moves added to its end, which take no searching. */
+static void tree_changed(ChessGame* game, ChessVariation* variation)
+{
+    size_t ply;
+
+    if (game->compact)
+        return;
+
+    if (variation == game->mainline_end)
+        ply = chess_array_size(&game->mainline);
+    else if (!mainline_ply(variation, &ply))
+        return;
+
+    cache_mainline_from(game, variation, ply);
+}
+
+/* Builds the tree from a compact mainline */
+static void expand_mainline(ChessGame* game)
+{
+    const PackedMove* moves;
+    ChessVariation* variation = game->root_variation;
+    size_t ply, i;
+
+    if (!game->compact)
+        return;
+
+    ply = chess_array_size(&game->mainline);
+    if (ply > 0)
+    {
+        moves = chess_array_data(&game->mainline);
+        for (i = 0; i < ply; i++)
+            variation = chess_variation_add_child(variation, unpack_move(moves[i]));
+    }
+
+    /* The array is still the mainline, so it starts out as the cache */
+    game->mainline_end = variation;
+    game->compact = CHESS_FALSE;
+}
+
 void chess_game_reset_position(ChessGame* game, const ChessPosition* position)
 {
     chess_position_copy(position, &game->initial_position);
-    chess_variation_truncate(game->root_variation);
+    clear_moves(game);
+    drop_deferred_moves(game);
 
     game->result = chess_position_check_result(position);
     chess_string_clear(&game->event);
@@ -124,14 +256,41 @@ void chess_game_reset_fen(ChessGame* game, const char* fen)
 void chess_game_set_root_variation(ChessGame* game, ChessVariation* variation)
 {
     assert(chess_variation_is_root(variation));
-    chess_variation_truncate(game->root_variation);
+    drop_deferred_moves(game);
+    clear_moves(game);
     chess_variation_attach_subvariation(game->root_variation, variation);
+    game->compact = (game->root_variation->first_child == NULL);
+    if (!game->compact)
+        cache_mainline(game);
 }
 
 void chess_game_set_initial_position(ChessGame* game, const ChessPosition* position)
 {
     chess_position_copy(position, &game->initial_position);
-    chess_variation_truncate(game->root_variation);
+    clear_moves(game);
+    drop_deferred_moves(game);
+}
+
+void chess_game_defer_moves(ChessGame* game, ChessGameMovesFunc func,
+    const char* text, size_t size)
+{
+    clear_moves(game);
+    game->moves_func = func;
+    game->moves_text = text;
+    game->moves_size = size;
+    game->moves_ok = CHESS_TRUE;
+}
+
+ChessBoolean chess_game_load_moves(ChessGame* game)
+{
+    ChessGameMovesFunc func = game->moves_func;
+    if (func)
+    {
+        /* Cleared first, as the function will want the root variation */
+        game->moves_func = NULL;
+        game->moves_ok = func(game, game->moves_text, game->moves_size);
+    }
+    return game->moves_ok;
 }
 
 const ChessPosition* chess_game_initial_position(const ChessGame* game)
@@ -139,21 +298,55 @@ const ChessPosition* chess_game_initial_position(const ChessGame* game)
     return &game->initial_position;
 }
 
-ChessVariation* chess_game_root_variation(const ChessGame* game)
+void chess_game_expand(ChessGame* game)
+{
+    chess_game_load_moves(game);
+    expand_mainline(game);
+}
+
+ChessVariation* chess_game_root_variation(ChessGame* game)
+{
+    chess_game_expand(game);
+    return game->root_variation;
+}
+
+const ChessVariation* chess_game_tree(const ChessGame* game)
 {
     return game->root_variation;
 }
 
+ChessBoolean chess_game_is_compact(const ChessGame* game)
+{
+    return game->compact;
+}
+
 size_t chess_game_ply(const ChessGame* game)
 {
-    /* TODO: More efficient implementation */
-    return chess_variation_length(game->root_variation);
+    return chess_array_size(&game->mainline);
 }
 
 ChessMove chess_game_move_at_ply(const ChessGame* game, size_t ply)
 {
-    ChessVariation* variation = chess_variation_ply(game->root_variation, ply);
-    return variation->move;
+    return unpack_move(*(const PackedMove*)chess_array_elem(&game->mainline, ply));
+}
+
+void chess_game_append_move(ChessGame* game, ChessMove move)
+{
+    ChessVariation* variation;
+    PackedMove packed;
+
+    chess_game_load_moves(game);
+    if (game->compact)
+    {
+        packed = pack_move(move);
+        chess_array_push(&game->mainline, &packed);
+        return;
+    }
+
+    variation = game->root_variation;
+    while (variation->first_child)
+        variation = variation->first_child;
+    chess_variation_add_child(variation, move);
 }
 
 const char* chess_game_event(const ChessGame* game)
@@ -379,13 +572,15 @@ void chess_game_iterator_init(ChessGameIterator* iter, ChessGame* game)
 {
     iter->game = game;
     chess_position_copy(&game->initial_position, &iter->position);
-    iter->variation = game->root_variation;
+    iter->variation = chess_game_root_variation(game);
     chess_array_init(&iter->unmoves, sizeof(ChessUnmove));
+    chess_array_init(&iter->hashes, sizeof(ChessHash));
 }
 
 void chess_game_iterator_cleanup(ChessGameIterator* iter)
 {
     chess_array_cleanup(&iter->unmoves);
+    chess_array_cleanup(&iter->hashes);
 }
 
 ChessGame* chess_game_iterator_game(const ChessGameIterator* iter)
@@ -419,21 +614,66 @@ ChessResult chess_game_iterator_check_result(const ChessGameIterator* iter)
     return chess_position_check_result(&iter->position);
 }
 
+int chess_game_iterator_repetitions(const ChessGameIterator* iter)
+{
+    const ChessHash* hashes;
+    ChessHash hash = chess_position_hash(&iter->position);
+    size_t ply = chess_array_size(&iter->hashes);
+    size_t reach = iter->position.fifty, i;
+    int count = 1;
+
+    if (reach > ply)
+        reach = ply;
+    if (reach < 2)
+        return count;
+
+    /* Only every other position has the same side to move */
+    hashes = chess_array_data(&iter->hashes);
+    for (i = 2; i <= reach; i += 2)
+    {
+        if (hashes[ply - i] == hash)
+            count++;
+    }
+    return count;
+}
+
+ChessBoolean chess_game_iterator_is_repetition_draw(const ChessGameIterator* iter)
+{
+    return chess_game_iterator_repetitions(iter) >= 3;
+}
+
+ChessBoolean chess_game_iterator_is_fifty_move_draw(const ChessGameIterator* iter)
+{
+    ChessResult result;
+
+    if (iter->position.fifty < 100)
+        return CHESS_FALSE;
+
+    result = chess_position_check_result(&iter->position);
+    return result != CHESS_RESULT_WHITE_WINS && result != CHESS_RESULT_BLACK_WINS;
+}
+
 static void advance_current_position(ChessGameIterator* iter, ChessMove move)
 {
+    ChessHash hash = chess_position_hash(&iter->position);
     ChessUnmove unmove = chess_position_make_move(&iter->position, move);
     chess_array_push(&iter->unmoves, &unmove);
+    chess_array_push(&iter->hashes, &hash);
 }
 
 static void retreat_current_position(ChessGameIterator* iter)
 {
     ChessUnmove unmove;
+    ChessHash hash;
     chess_array_pop(&iter->unmoves, &unmove);
+    chess_array_pop(&iter->hashes, &hash);
     chess_position_undo_move(&iter->position, unmove);
 }
 
 void chess_game_iterator_append_move(ChessGameIterator* iter, ChessMove move)
 {
+    /* The game may have been reset to compact since the iterator started */
+    chess_game_expand(iter->game);
     advance_current_position(iter, move);
     iter->variation = chess_variation_add_child(iter->variation, move);
 }
@@ -463,6 +703,7 @@ void chess_game_iterator_step_to_start(ChessGameIterator* iter)
     chess_position_copy(&iter->game->initial_position, &iter->position);
     iter->variation = iter->game->root_variation;
     chess_array_clear(&iter->unmoves);
+    chess_array_clear(&iter->hashes);
 }
 
 void chess_game_iterator_step_to_end(ChessGameIterator* iter)
@@ -19,8 +19,36 @@ void chess_game_reset_fen(ChessGame*, const char*);
 void chess_game_set_root_variation(ChessGame*, ChessVariation*);
 void chess_game_set_initial_position(ChessGame*, const ChessPosition*);
 
+/* A game's moves can be left as text until they're loaded, which happens
+ * when the game is changed or expanded (through the root variation or an
+ * iterator) or by calling chess_game_load_moves. The function is then
+ * called to read them into the game, returning whether it read them all.
+ * The text must stay valid until then, and is dropped if the game is reset
+ * or given other moves first. */
+typedef ChessBoolean (*ChessGameMovesFunc)(ChessGame*, const char* text, size_t size);
+void chess_game_defer_moves(ChessGame*, ChessGameMovesFunc, const char* text, size_t size);
+/* Reads any deferred moves now. Returns CHESS_FALSE if they couldn't all be
+ * read, in which case the game has the moves up to the problem. */
+ChessBoolean chess_game_load_moves(ChessGame*);
+
 const ChessPosition* chess_game_initial_position(const ChessGame*);
-ChessVariation* chess_game_root_variation(const ChessGame*);
+
+/* A game without variations, comments or annotations can keep its moves as
+ * a compact array instead of a tree. Games start out compact and stay so as
+ * moves are appended, until expanded: this loads any deferred moves and
+ * builds the tree, whose mainline is kept cached for the ply accessors as
+ * the tree changes. The root variation expands the game, so it can be
+ * changed through the tree. The game owns the root's changed function. */
+void chess_game_expand(ChessGame*);
+ChessVariation* chess_game_root_variation(ChessGame*);
+ChessBoolean chess_game_is_compact(const ChessGame*);
+void chess_game_append_move(ChessGame*, ChessMove);
+
+/* The const accessors only read the game as it is, so they're safe to use
+ * from several threads at once. Deferred moves aren't loaded: until then
+ * the game has none. The tree of a compact game has no moves under the
+ * root. The ply accessors take constant time. */
+const ChessVariation* chess_game_tree(const ChessGame*);
 size_t chess_game_ply(const ChessGame*);
 ChessMove chess_game_move_at_ply(const ChessGame*, size_t ply);
 
@@ -65,6 +93,7 @@ typedef struct ChessGameIterator
     ChessVariation* variation;
     ChessPosition position;
     ChessArray unmoves; /* private */
+    ChessArray hashes; /* private, of the position before each move */
 } ChessGameIterator;
 
 void chess_game_iterator_init(ChessGameIterator*, ChessGame*);
@@ -74,6 +103,15 @@ ChessMove chess_game_iterator_move(const ChessGameIterator*);
 size_t chess_game_iterator_ply(const ChessGameIterator*);
 ChessResult chess_game_iterator_check_result(const ChessGameIterator*);
 
+/* How many times the current position has been reached, counting this one.
+ * Only looks back as far as the last capture or pawn move. */
+int chess_game_iterator_repetitions(const ChessGameIterator*);
+
+/* Whether a draw may be claimed, by threefold repetition or by fifty moves
+ * without a capture or pawn move that didn't end in mate */
+ChessBoolean chess_game_iterator_is_repetition_draw(const ChessGameIterator*);
+ChessBoolean chess_game_iterator_is_fifty_move_draw(const ChessGameIterator*);
+
 void chess_game_iterator_append_move(ChessGameIterator*, ChessMove move);
 void chess_game_iterator_truncate_moves(ChessGameIterator*);
 
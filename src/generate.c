@@ -1,7 +1,9 @@
 #include <assert.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "generate.h"
+#include "zobrist.h"
 
 typedef enum {
     DIR_N = (1 << 0),
@@ -43,22 +45,180 @@ static int dirs_array[] = { DIR_N, DIR_NE, DIR_E, DIR_SE, DIR_S, DIR_SW, DIR_W,
 static int slides_array[] = { SLIDE_N, SLIDE_NE, SLIDE_E, SLIDE_SE, SLIDE_S, SLIDE_SW, SLIDE_W, SLIDE_NW };
 static int jumps_array[] = { JUMP_NNE, JUMP_ENE, JUMP_ESE, JUMP_SSE, JUMP_SSW, JUMP_WSW, JUMP_WNW, JUMP_NNW };
 
-static int rook_dirs = DIR_N | DIR_E | DIR_S | DIR_W;
-static int bishop_dirs = DIR_NE | DIR_SE | DIR_SW | DIR_NW;
-static int queen_dirs = 0xff;
+/* Attack sets for each square, indexed the same way as the arrays above */
+static ChessBitboard rays[8][64];
+static ChessBitboard knight_attacks[64];
+static ChessBitboard king_attacks[64];
+static ChessBitboard pawn_attacks[2][64];
+
+/* For two squares sharing a rank, file or diagonal, the squares strictly
+ * between them and the whole line through them; empty otherwise */
+static ChessBitboard between[64][64];
+static ChessBitboard line[64][64];
+
+/* Sliding attacks are looked up with "fancy" magic bitboards: the relevant
+ * occupancy for a square is multiplied by a magic constant, and the top bits
+ * of the product index that square's slice of a shared attack table. */
+typedef struct
+{
+    ChessBitboard mask;
+    ChessBitboard magic;
+    ChessBitboard* attacks;
+    int shift;
+} Magic;
+
+#define MAGIC(hi, lo) (((ChessBitboard)(hi) << 32) | (ChessBitboard)(lo))
+
+static const ChessBitboard rook_magic_numbers[64] = {
+    MAGIC(0x10800040, 0x08801020), MAGIC(0x08400920, 0x02c03000),
+    MAGIC(0x19002000, 0x10400900), MAGIC(0x08801000, 0x08000480),
+    MAGIC(0x42001004, 0x20080200), MAGIC(0x81000201, 0x00080400),
+    MAGIC(0x02000401, 0x10886200), MAGIC(0x02000080, 0x40220411),
+    MAGIC(0x04048000, 0x84400220), MAGIC(0x00004010, 0x00402000),
+    MAGIC(0x00860010, 0x81220440), MAGIC(0x04088008, 0x00100280),
+    MAGIC(0x000a0012, 0x01040820), MAGIC(0x88488002, 0x00840080),
+    MAGIC(0x40010001, 0x00040200), MAGIC(0x04420001, 0x02105084),
+    MAGIC(0x90800100, 0x20804100), MAGIC(0x00404040, 0x00201009),
+    MAGIC(0x00008080, 0x10002009), MAGIC(0x22000900, 0x21d00100),
+    MAGIC(0x00080080, 0x08040080), MAGIC(0x00040040, 0x02010040),
+    MAGIC(0x00110400, 0x08015042), MAGIC(0x00000a00, 0x01768104),
+    MAGIC(0x00008000, 0x80204009), MAGIC(0x20100041, 0x40002001),
+    MAGIC(0x98002002, 0x80100080), MAGIC(0x10001000, 0x80080080),
+    MAGIC(0x0442000a, 0x00049020), MAGIC(0x21000400, 0x80020080),
+    MAGIC(0x08001204, 0x00900148), MAGIC(0x0010040a, 0x00128541),
+    MAGIC(0x28008040, 0x00800030), MAGIC(0x10100020, 0x00400041),
+    MAGIC(0x40002000, 0x11004100), MAGIC(0x06100084, 0x10800800),
+    MAGIC(0x04008024, 0x02800800), MAGIC(0xc1000200, 0x80800400),
+    MAGIC(0x00020008, 0x02000401), MAGIC(0x01820858, 0x82000401),
+    MAGIC(0x02202040, 0x00808000), MAGIC(0x28601000, 0x40024022),
+    MAGIC(0x00010020, 0x04110040), MAGIC(0x99101042, 0x000a0020),
+    MAGIC(0x00040800, 0x04008080), MAGIC(0x00100400, 0x02008080),
+    MAGIC(0x20120048, 0x81020004), MAGIC(0x83008424, 0x44820011),
+    MAGIC(0x00884038, 0x82010200), MAGIC(0x08204000, 0x80210100),
+    MAGIC(0x01109100, 0x40a00300), MAGIC(0x08011002, 0x80080480),
+    MAGIC(0x02420090, 0x08200600), MAGIC(0x10020004, 0x89500200),
+    MAGIC(0x00408002, 0x00010080), MAGIC(0x00918000, 0x41000080),
+    MAGIC(0x00002093, 0x00488001), MAGIC(0x04c10024, 0x14824001),
+    MAGIC(0x02002000, 0x0b001041), MAGIC(0x70001000, 0x04200901),
+    MAGIC(0x80020020, 0x04100802), MAGIC(0x30010002, 0x084c0007),
+    MAGIC(0x08882218, 0x00813004), MAGIC(0x40000028, 0x40840112)
+};
+
+static const ChessBitboard bishop_magic_numbers[64] = {
+    MAGIC(0xa0100411, 0x08003100), MAGIC(0x00608202, 0x0a002900),
+    MAGIC(0x68100106, 0x19200000), MAGIC(0x08281a05, 0x20000408),
+    MAGIC(0x00011040, 0x01000400), MAGIC(0x00189010, 0x08048400),
+    MAGIC(0x00040a02, 0x10245280), MAGIC(0x00020021, 0x0808a402),
+    MAGIC(0x91400484, 0x10821200), MAGIC(0x08000910, 0x10820041),
+    MAGIC(0x20504804, 0x832202c0), MAGIC(0x01000914, 0x01081000),
+    MAGIC(0x80210111, 0x40000012), MAGIC(0x08100208, 0x04450400),
+    MAGIC(0x208b0542, 0x109008a2), MAGIC(0x0080084a, 0x08040204),
+    MAGIC(0x0040e2a8, 0x0811244c), MAGIC(0x25050220, 0x08008108),
+    MAGIC(0x04302201, 0x00420040), MAGIC(0x010a0404, 0x20220040),
+    MAGIC(0x11050002, 0x90400000), MAGIC(0x00930012, 0x00822120),
+    MAGIC(0x4000a620, 0x48043004), MAGIC(0x28012004, 0x8a015004),
+    MAGIC(0x00609000, 0x2a020814), MAGIC(0x44042000, 0x240800d0),
+    MAGIC(0x01102800, 0x040a4400), MAGIC(0x10040800, 0x80220040),
+    MAGIC(0x00010010, 0x11004024), MAGIC(0x00100440, 0x00805040),
+    MAGIC(0x09140412, 0x00820100), MAGIC(0x00048210, 0x12821480),
+    MAGIC(0x00240405, 0x00c05021), MAGIC(0x00886110, 0x02080200),
+    MAGIC(0x0116080a, 0x00040020), MAGIC(0x40000200, 0x80080080),
+    MAGIC(0x24504501, 0x40840040), MAGIC(0x00008802, 0x01484100),
+    MAGIC(0x02220204, 0x04020092), MAGIC(0x80811106, 0x00002e00),
+    MAGIC(0x28421011, 0x05000801), MAGIC(0x11008090, 0x08001025),
+    MAGIC(0x00020202, 0x221c0400), MAGIC(0x04220140, 0x22009020),
+    MAGIC(0x02100461, 0x02100c00), MAGIC(0xc0040080, 0x82029102),
+    MAGIC(0x00aa4618, 0x01101200), MAGIC(0x04040800, 0x80201108),
+    MAGIC(0x02054210, 0x8c205002), MAGIC(0x04105448, 0x04100100),
+    MAGIC(0x00409108, 0x41100000), MAGIC(0x04002000, 0x42021100),
+    MAGIC(0x00004204, 0x850400c0), MAGIC(0x02001004, 0x10a42102),
+    MAGIC(0x10400208, 0x01210102), MAGIC(0x08050404, 0x10420000),
+    MAGIC(0x28848041, 0x30100200), MAGIC(0x800c2622, 0x01242000),
+    MAGIC(0x10580001, 0x94108800), MAGIC(0x00142210, 0x54420204),
+    MAGIC(0x01040000, 0x12a02200), MAGIC(0x02008810, 0x03300100),
+    MAGIC(0x01404002, 0x02840100), MAGIC(0x04020208, 0x01010201)
+};
+
+static Magic rook_magics[64];
+static Magic bishop_magics[64];
+static ChessBitboard rook_table[102400];
+static ChessBitboard bishop_table[5248];
+
+#define MAGIC_INDEX(m, occupied) ((size_t)((((occupied) & (m)->mask) * (m)->magic) >> (m)->shift))
+#define ROOK_ATTACKS(sq, occupied) (rook_magics[sq].attacks[MAGIC_INDEX(&rook_magics[sq], occupied)])
+#define BISHOP_ATTACKS(sq, occupied) (bishop_magics[sq].attacks[MAGIC_INDEX(&bishop_magics[sq], occupied)])
+
+static ChessBitboard ray_attacks(ChessSquare sq, int d, ChessBitboard occupied)
+{
+    ChessBitboard attacks = rays[d][sq];
+    ChessBitboard blockers = attacks & occupied;
+    ChessSquare blocker;
 
-void chess_generate_init(void)
+    if (blockers)
+    {
+        /* Everything beyond the nearest blocker is hidden */
+        blocker = (slides_array[d] > 0) ? CHESS_BITBOARD_LSB(blockers) : CHESS_BITBOARD_MSB(blockers);
+        attacks ^= rays[d][blocker];
+    }
+    return attacks;
+}
+
+static ChessBitboard slide_attacks(ChessSquare sq, int piece_dirs, ChessBitboard occupied)
+{
+    ChessBitboard attacks = CHESS_BITBOARD_EMPTY;
+    int d;
+
+    for (d = 0; d < 8; d++)
+    {
+        if (dirs_array[d] & piece_dirs)
+            attacks |= ray_attacks(sq, d, occupied);
+    }
+    return attacks;
+}
+
+static ChessBitboard* init_magic(Magic* m, ChessSquare sq, ChessBitboard magic,
+    int piece_dirs, ChessBitboard* table)
+{
+    ChessBitboard subset, edges;
+    int d, bits;
+
+    /* Blockers on the last square of a ray never change the attack set */
+    m->mask = CHESS_BITBOARD_EMPTY;
+    for (d = 0; d < 8; d++)
+    {
+        if ((dirs_array[d] & piece_dirs) && rays[d][sq])
+        {
+            edges = rays[d][sq];
+            edges &= ~CHESS_BITBOARD_SQUARE((slides_array[d] > 0) ? CHESS_BITBOARD_MSB(edges) : CHESS_BITBOARD_LSB(edges));
+            m->mask |= edges;
+        }
+    }
+
+    bits = CHESS_BITBOARD_COUNT(m->mask);
+    m->magic = magic;
+    m->shift = 64 - bits;
+    m->attacks = table;
+
+    /* Enumerate every subset of the mask (Carry-Rippler) */
+    subset = CHESS_BITBOARD_EMPTY;
+    do
+    {
+        m->attacks[MAGIC_INDEX(m, subset)] = slide_attacks(sq, piece_dirs, subset);
+        subset = (subset - m->mask) & m->mask;
+    } while (subset != CHESS_BITBOARD_EMPTY);
+
+    return table + ((size_t)1 << bits);
+}
+
+static void init_tables(void)
 {
-    static int initialized = 0;
     ChessSquare sq;
     int dirs, d;
     int slide, jump;
     int file, rank;
     int to_file, to_rank;
-
-    if (initialized)
-        return;
-    initialized = 1;
+    ChessBitboard* rook_next, *bishop_next;
+    ChessBitboard path;
 
     for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
     {
@@ -95,372 +255,458 @@ void chess_generate_init(void)
 
         jump_dirs[sq] = dirs;
     }
+
+    for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
+    {
+        for (d = 0; d < 8; d++)
+        {
+            if (jump_dirs[sq] & dirs_array[d])
+                knight_attacks[sq] |= CHESS_BITBOARD_SQUARE(sq + jumps_array[d]);
+
+            if (slide_dirs[sq] & dirs_array[d])
+            {
+                king_attacks[sq] |= CHESS_BITBOARD_SQUARE(sq + slides_array[d]);
+                if (dirs_array[d] & (DIR_NE | DIR_NW))
+                    pawn_attacks[CHESS_COLOR_WHITE][sq] |= CHESS_BITBOARD_SQUARE(sq + slides_array[d]);
+                if (dirs_array[d] & (DIR_SE | DIR_SW))
+                    pawn_attacks[CHESS_COLOR_BLACK][sq] |= CHESS_BITBOARD_SQUARE(sq + slides_array[d]);
+            }
+
+            for (slide = sq; slide_dirs[slide] & dirs_array[d]; )
+            {
+                slide += slides_array[d];
+                rays[d][sq] |= CHESS_BITBOARD_SQUARE(slide);
+            }
+        }
+    }
+
+    for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
+    {
+        for (d = 0; d < 8; d++)
+        {
+            path = CHESS_BITBOARD_EMPTY;
+            for (slide = sq; slide_dirs[slide] & dirs_array[d]; )
+            {
+                slide += slides_array[d];
+                between[sq][slide] = path;
+                line[sq][slide] = rays[d][sq] | rays[(d + 4) % 8][sq] | CHESS_BITBOARD_SQUARE(sq);
+                path |= CHESS_BITBOARD_SQUARE(slide);
+            }
+        }
+    }
+
+    rook_next = rook_table;
+    bishop_next = bishop_table;
+    for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
+    {
+        rook_next = init_magic(&rook_magics[sq], sq, rook_magic_numbers[sq],
+            DIR_N | DIR_E | DIR_S | DIR_W, rook_next);
+        bishop_next = init_magic(&bishop_magics[sq], sq, bishop_magic_numbers[sq],
+            DIR_NE | DIR_SE | DIR_SW | DIR_NW, bishop_next);
+    }
+    assert(rook_next == rook_table + sizeof(rook_table) / sizeof(ChessBitboard));
+    assert(bishop_next == bishop_table + sizeof(bishop_table) / sizeof(ChessBitboard));
+
+    chess_zobrist_init();
 }
 
-static ChessBoolean move_is_legal(const ChessPosition* position, ChessMove move)
+void chess_generate_init(void)
 {
-    ChessPosition temp_position;
-    chess_position_copy(position, &temp_position);
-    chess_position_make_move(&temp_position,  move);
-    temp_position.to_move = position->to_move;
-    return !chess_position_is_check(&temp_position);
+    /* Safe to call from any number of threads at once */
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, init_tables);
 }
 
-void chess_move_generator_init(ChessMoveGenerator* gen, const ChessPosition* position)
+/* All the pieces of the given color attacking sq, seen through the given
+ * occupancy. Pieces missing from the occupancy are treated as captured. */
+static ChessBitboard attackers_of(const ChessPosition* position, ChessSquare sq,
+    ChessColor color, ChessBitboard occupied)
 {
-    gen->position = position;
-    gen->sq = 0;
-    gen->to = CHESS_SQUARE_INVALID;
-    gen->d = 0;
-    gen->promote = CHESS_MOVE_PROMOTE_NONE;
-    gen->castle = -1;
+    const ChessBitboard* bitboards = position->bitboards;
+    ChessBitboard queens = bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_QUEEN, color)];
+    ChessBitboard attackers;
+
+    attackers = knight_attacks[sq] & bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_KNIGHT, color)];
+    attackers |= king_attacks[sq] & bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_KING, color)];
+
+    /* A pawn attacks sq from the squares an opposing pawn on sq would attack */
+    attackers |= pawn_attacks[chess_color_other(color)][sq] & bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color)];
+
+    attackers |= BISHOP_ATTACKS(sq, occupied) & (bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_BISHOP, color)] | queens);
+    attackers |= ROOK_ATTACKS(sq, occupied) & (bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_ROOK, color)] | queens);
+
+    return attackers & occupied;
 }
 
-static ChessMove gen_next(ChessMoveGenerator* gen)
+/* Whether the side to move has the right to castle to king_to, with nothing
+ * in the way and no attacks on the squares the king crosses. The king's own
+ * square is left to the caller. */
+static ChessBoolean castle_path_is_safe(const ChessPosition* position, ChessSquare king_to)
 {
-    const ChessPosition* position = gen->position;
-    ChessPiece piece;
-    ChessColor color = position->to_move;
-    ChessPiece target;
-    int dirs, dir;
-    int piece_dirs;
+    ChessColor other = chess_color_other(position->to_move);
+    ChessBitboard occupied = position->occupied[CHESS_COLOR_WHITE] | position->occupied[CHESS_COLOR_BLACK];
+    ChessCastleState right;
+    ChessBitboard empty;
+    ChessSquare crossed;
+
+    switch (king_to)
+    {
+        case CHESS_SQUARE_G1:
+            right = CHESS_CASTLE_STATE_WK;
+            empty = CHESS_BITBOARD_SQUARE(CHESS_SQUARE_F1) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_G1);
+            crossed = CHESS_SQUARE_F1;
+            break;
+        case CHESS_SQUARE_C1:
+            right = CHESS_CASTLE_STATE_WQ;
+            empty = CHESS_BITBOARD_SQUARE(CHESS_SQUARE_B1) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_C1) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_D1);
+            crossed = CHESS_SQUARE_D1;
+            break;
+        case CHESS_SQUARE_G8:
+            right = CHESS_CASTLE_STATE_BK;
+            empty = CHESS_BITBOARD_SQUARE(CHESS_SQUARE_F8) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_G8);
+            crossed = CHESS_SQUARE_F8;
+            break;
+        case CHESS_SQUARE_C8:
+            right = CHESS_CASTLE_STATE_BQ;
+            empty = CHESS_BITBOARD_SQUARE(CHESS_SQUARE_B8) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_C8) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_D8);
+            crossed = CHESS_SQUARE_D8;
+            break;
+        default:
+            return CHESS_FALSE;
+    }
 
+    /* Only the side to move's own rights count */
+    if (chess_square_rank(king_to) != ((position->to_move == CHESS_COLOR_WHITE) ? CHESS_RANK_1 : CHESS_RANK_8))
+        return CHESS_FALSE;
+
+    return (position->castle & right) && !(occupied & empty)
+        && !attackers_of(position, crossed, other, occupied)
+        && !attackers_of(position, king_to, other, occupied);
+}
+
+#define ADD_MOVE(move) \
+    do { \
+        assert(n < CHESS_GENERATE_MAX_MOVES); \
+        if (n < CHESS_GENERATE_MAX_MOVES) \
+            moves[n++] = (move); \
+    } while (0)
+
+#define ADD_PAWN_MOVES(from, to) \
+    do { \
+        if (chess_square_rank(to) == end_rank) \
+        { \
+            for (promote = CHESS_MOVE_PROMOTE_KNIGHT; promote <= CHESS_MOVE_PROMOTE_QUEEN; promote++) \
+                ADD_MOVE(chess_move_make_promote(from, to, promote)); \
+        } \
+        else \
+        { \
+            ADD_MOVE(chess_move_make(from, to)); \
+        } \
+    } while (0)
+
+/* Generates only legal moves. Checkers and pinned pieces are found once per
+ * position, and every piece is then restricted to the squares that resolve
+ * the check and keep it on its pin line. Only king moves and en passant,
+ * which can uncover an attack on the king, are tested individually. */
+size_t chess_generate_moves(const ChessPosition* position, ChessMove* moves)
+{
+    ChessColor color = position->to_move;
+    ChessColor other = chess_color_other(color);
+    const ChessBitboard* bitboards = position->bitboards;
+    ChessBitboard own = position->occupied[color];
+    ChessBitboard enemy = position->occupied[other];
+    ChessBitboard occupied = own | enemy;
+    ChessSquare king = (color == CHESS_COLOR_WHITE) ? position->wking : position->bking;
+    ChessBitboard checkers, pinned, snipers, target, allowed, pieces, attacks, blockers;
+    ChessSquare from, to, ep, captured;
     ChessRank start_rank, end_rank;
+    ChessMovePromote promote;
     int slide;
-    int capture_dirs;
-    ChessFile ep_file;
-    ChessSquare ep;
-    ChessMove move;
+    size_t n = 0;
 
-    if (gen->promote != CHESS_MOVE_PROMOTE_NONE)
+    /* The king must not step onto an attacked square, including squares
+     * behind it on the line of a checking slider */
+    attacks = king_attacks[king] & ~own;
+    while (attacks)
     {
-gen_pawn_promotes:
-        if (++gen->promote <= CHESS_MOVE_PROMOTE_QUEEN)
-            return chess_move_make_promote(gen->sq, gen->to, gen->promote);
-        gen->promote = CHESS_MOVE_PROMOTE_NONE;
+        to = chess_bitboard_pop(&attacks);
+        if (!attackers_of(position, to, other, occupied ^ CHESS_BITBOARD_SQUARE(king)))
+            ADD_MOVE(chess_move_make(king, to));
     }
 
-    for (; gen->sq <= CHESS_SQUARE_H8; gen->sq++)
+    checkers = attackers_of(position, king, other, occupied);
+    if (CHESS_BITBOARD_COUNT(checkers) > 1)
+        return n;
+
+    /* Any other move must capture a single checker or block its line */
+    target = checkers ? checkers | between[king][CHESS_BITBOARD_LSB(checkers)] : ~own;
+
+    /* A piece is pinned when it is the only one between the king and an
+     * enemy slider on the same line */
+    pinned = CHESS_BITBOARD_EMPTY;
+    snipers = ROOK_ATTACKS(king, CHESS_BITBOARD_EMPTY)
+        & (bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_ROOK, other)]
+        | bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_QUEEN, other)]);
+    snipers |= BISHOP_ATTACKS(king, CHESS_BITBOARD_EMPTY)
+        & (bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_BISHOP, other)]
+        | bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_QUEEN, other)]);
+    while (snipers)
     {
-        piece = position->piece[gen->sq];
-        if (piece == CHESS_PIECE_NONE)
-            continue;
+        blockers = between[king][chess_bitboard_pop(&snipers)] & occupied;
+        if ((blockers & own) && CHESS_BITBOARD_COUNT(blockers) == 1)
+            pinned |= blockers;
+    }
 
-        if (color != chess_piece_color(piece))
-            continue;
+    /* A pinned knight can never move */
+    pieces = bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_KNIGHT, color)] & ~pinned;
+    while (pieces)
+    {
+        from = chess_bitboard_pop(&pieces);
+        attacks = knight_attacks[from] & target;
+        while (attacks)
+            ADD_MOVE(chess_move_make(from, chess_bitboard_pop(&attacks)));
+    }
 
-        switch (piece)
-        {
-            case CHESS_PIECE_WHITE_PAWN:
-            case CHESS_PIECE_BLACK_PAWN:
-                start_rank = (color == CHESS_COLOR_WHITE) ? CHESS_RANK_2 : CHESS_RANK_7;
-                end_rank = (color == CHESS_COLOR_WHITE) ? CHESS_RANK_8 : CHESS_RANK_1;
-                slide = (color == CHESS_COLOR_WHITE) ? SLIDE_N : SLIDE_S;
-                capture_dirs = (color == CHESS_COLOR_WHITE) ? DIR_NE | DIR_NW : DIR_SE | DIR_SW;
-                dirs = capture_dirs & slide_dirs[gen->sq];
-                ep_file = position->ep;
-                ep = (ep_file == CHESS_FILE_INVALID) ? CHESS_SQUARE_INVALID :
-                     chess_square_from_fr(ep_file, (color == CHESS_COLOR_WHITE) ? CHESS_RANK_6 : CHESS_RANK_3);
-
-                if (gen->d == 0)
-                {
-                    if (gen->to == CHESS_SQUARE_INVALID)
-                    {
-                        gen->to = gen->sq + slide;
-
-                        if (position->piece[gen->to] == CHESS_PIECE_NONE)
-                        {
-                            if (chess_square_rank(gen->to) == end_rank)
-                                goto gen_pawn_promotes;
-                            else
-                                return chess_move_make(gen->sq, gen->to);
-                        }
-                    }
-                    else if (chess_square_rank(gen->sq) == start_rank && gen->to == gen->sq + slide)
-                    {
-                        gen->to += slide;
-                        if (position->piece[gen->to] == CHESS_PIECE_NONE)
-                            return chess_move_make(gen->sq, gen->to);
-                    }
-                    gen->to = CHESS_SQUARE_INVALID;
-                    gen->d = 1;
-                }
-
-                while (gen->d < 8)
-                {
-                    if (dirs_array[gen->d] & dirs)
-                    {
-                        gen->to = gen->sq + slides_array[gen->d];
-                        piece = position->piece[gen->to];
-                        gen->d += 2;
-                        if (piece != CHESS_PIECE_NONE && chess_piece_color(piece) != color)
-                        {
-                            if (chess_square_rank(gen->to) == end_rank)
-                                goto gen_pawn_promotes;
-                            else
-                                return chess_move_make(gen->sq, gen->to);
-                        }
-                        else if (gen->to == ep)
-                        {
-                            return chess_move_make(gen->sq, gen->to);
-                        }
-                    }
-                    else
-                    {
-                        gen->d += 2;
-                    }
-                }
-                gen->to = CHESS_SQUARE_INVALID;
-                gen->d = 0;
-                break;
-            case CHESS_PIECE_WHITE_KNIGHT:
-            case CHESS_PIECE_BLACK_KNIGHT:
-                dirs = jump_dirs[gen->sq];
-                for (; gen->d < 8; gen->d++)
-                {
-                    dir = dirs_array[gen->d];
-                    if ((dir & dirs) == 0)
-                        continue;
-
-                    gen->to = gen->sq + jumps_array[gen->d];
-                    target = position->piece[gen->to];
-                    if (target == CHESS_PIECE_NONE || chess_piece_color(target) != color)
-                    {
-                        gen->d++;
-                        return chess_move_make(gen->sq, gen->to);
-                    }
-                }
-                gen->to = CHESS_SQUARE_INVALID;
-                gen->d = 0;
-                break;
-            case CHESS_PIECE_WHITE_BISHOP:
-            case CHESS_PIECE_BLACK_BISHOP:
-                piece_dirs = bishop_dirs;
-                goto gen_slide_moves;
-            case CHESS_PIECE_WHITE_ROOK:
-            case CHESS_PIECE_BLACK_ROOK:
-                piece_dirs = rook_dirs;
-                goto gen_slide_moves;
-            case CHESS_PIECE_WHITE_QUEEN:
-            case CHESS_PIECE_BLACK_QUEEN:
-                piece_dirs = queen_dirs;
-        gen_slide_moves:
-                while (gen->d < 8)
-                {
-                    dir = dirs_array[gen->d] & piece_dirs;
-
-                    if (gen->to == CHESS_SQUARE_INVALID)
-                        gen->to = gen->sq;
-
-                    do
-                    {
-                        dirs = slide_dirs[gen->to];
-                        if ((dir & dirs) == 0)
-                            break;
-
-                        gen->to += slides_array[gen->d];
-                        target = position->piece[gen->to];
-                        if (target == CHESS_PIECE_NONE)
-                            return chess_move_make(gen->sq, gen->to);
-                        else if (chess_piece_color(target) != color)
-                        {
-                            move = chess_move_make(gen->sq, gen->to);
-                            gen->d++;
-                            gen->to = CHESS_SQUARE_INVALID;
-                            return move;
-                        }
-                    } while (target == CHESS_PIECE_NONE);
-
-                    gen->to = CHESS_SQUARE_INVALID;
-                    gen->d++;
-                }
-                gen->to = CHESS_SQUARE_INVALID;
-                gen->d = 0;
-                break;
-            case CHESS_PIECE_WHITE_KING:
-            case CHESS_PIECE_BLACK_KING:
-                dirs = slide_dirs[gen->sq];
-                for (; gen->d < 8; gen->d++)
-                {
-                    dir = dirs_array[gen->d];
-                    if ((dir & dirs) == 0)
-                        continue;
-
-                    gen->to = gen->sq + slides_array[gen->d];
-                    target = position->piece[gen->to];
-                    if (target == CHESS_PIECE_NONE || chess_piece_color(target) != color)
-                    {
-                        gen->d++;
-                        return chess_move_make(gen->sq, gen->to);
-                    }
-                }
-                gen->to = CHESS_SQUARE_INVALID;
-                gen->d = 0;
-                break;
-            default:
-                assert(0);
-                break;
-        }
+    /* Queens are covered by both slider loops, one for each set of lines */
+    pieces = bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_BISHOP, color)]
+        | bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_QUEEN, color)];
+    while (pieces)
+    {
+        from = chess_bitboard_pop(&pieces);
+        attacks = BISHOP_ATTACKS(from, occupied) & target;
+        if (pinned & CHESS_BITBOARD_SQUARE(from))
+            attacks &= line[king][from];
+        while (attacks)
+            ADD_MOVE(chess_move_make(from, chess_bitboard_pop(&attacks)));
     }
 
-    if ((int)gen->castle == -1)
+    pieces = bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_ROOK, color)]
+        | bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_QUEEN, color)];
+    while (pieces)
     {
-        if (!chess_position_is_check(position))
-            gen->castle = position->castle;
-        else {
-            gen->castle = CHESS_CASTLE_STATE_NONE;
-        }
+        from = chess_bitboard_pop(&pieces);
+        attacks = ROOK_ATTACKS(from, occupied) & target;
+        if (pinned & CHESS_BITBOARD_SQUARE(from))
+            attacks &= line[king][from];
+        while (attacks)
+            ADD_MOVE(chess_move_make(from, chess_bitboard_pop(&attacks)));
     }
 
-    if (color == CHESS_COLOR_WHITE)
+    start_rank = (color == CHESS_COLOR_WHITE) ? CHESS_RANK_2 : CHESS_RANK_7;
+    end_rank = (color == CHESS_COLOR_WHITE) ? CHESS_RANK_8 : CHESS_RANK_1;
+    slide = (color == CHESS_COLOR_WHITE) ? SLIDE_N : SLIDE_S;
+
+    pieces = bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color)];
+    while (pieces)
     {
-        if ((gen->castle & CHESS_CASTLE_STATE_WK)
-            && position->piece[CHESS_SQUARE_F1] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_G1] == CHESS_PIECE_NONE
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_F1, CHESS_COLOR_BLACK)
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_G1, CHESS_COLOR_BLACK))
+        from = chess_bitboard_pop(&pieces);
+        allowed = target;
+        if (pinned & CHESS_BITBOARD_SQUARE(from))
+            allowed &= line[king][from];
+
+        to = from + slide;
+        if (!(occupied & CHESS_BITBOARD_SQUARE(to)))
         {
-            gen->castle &= ~CHESS_CASTLE_STATE_WK;
-            return chess_move_make(CHESS_SQUARE_E1, CHESS_SQUARE_G1);
+            if (allowed & CHESS_BITBOARD_SQUARE(to))
+                ADD_PAWN_MOVES(from, to);
+
+            to += slide;
+            if (chess_square_rank(from) == start_rank
+                && !(occupied & CHESS_BITBOARD_SQUARE(to))
+                && (allowed & CHESS_BITBOARD_SQUARE(to)))
+                ADD_MOVE(chess_move_make(from, to));
         }
 
-        if ((gen->castle & CHESS_CASTLE_STATE_WQ)
-            && position->piece[CHESS_SQUARE_B1] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_C1] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_D1] == CHESS_PIECE_NONE
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_D1, CHESS_COLOR_BLACK)
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_C1, CHESS_COLOR_BLACK))
+        attacks = pawn_attacks[color][from] & enemy & allowed;
+        while (attacks)
         {
-            gen->castle &= ~CHESS_CASTLE_STATE_WQ;
-            return chess_move_make(CHESS_SQUARE_E1, CHESS_SQUARE_C1);
+            to = chess_bitboard_pop(&attacks);
+            ADD_PAWN_MOVES(from, to);
         }
     }
-    else
-    {
-        if ((gen->castle & CHESS_CASTLE_STATE_BK)
-            && position->piece[CHESS_SQUARE_F8] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_G8] == CHESS_PIECE_NONE
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_F8, CHESS_COLOR_WHITE)
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_G8, CHESS_COLOR_WHITE))
-        {
-            gen->castle &= ~CHESS_CASTLE_STATE_BK;
-            return chess_move_make(CHESS_SQUARE_E8, CHESS_SQUARE_G8);
-        }
 
-        if ((gen->castle & CHESS_CASTLE_STATE_BQ)
-            && position->piece[CHESS_SQUARE_B8] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_C8] == CHESS_PIECE_NONE
-            && position->piece[CHESS_SQUARE_D8] == CHESS_PIECE_NONE
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_D8, CHESS_COLOR_WHITE)
-            && !chess_generate_is_square_attacked(position, CHESS_SQUARE_C8, CHESS_COLOR_WHITE))
+    /* En passant removes two pieces from the same rank, so it is tested
+     * directly against the occupancy it leaves behind */
+    if (position->ep != CHESS_FILE_INVALID)
+    {
+        ep = chess_square_from_fr(position->ep, (color == CHESS_COLOR_WHITE) ? CHESS_RANK_6 : CHESS_RANK_3);
+        captured = ep - slide;
+        pieces = pawn_attacks[other][ep] & bitboards[chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color)];
+        while (pieces)
         {
-            gen->castle &= ~CHESS_CASTLE_STATE_BQ;
-            return chess_move_make(CHESS_SQUARE_E8, CHESS_SQUARE_C8);
+            from = chess_bitboard_pop(&pieces);
+            blockers = (occupied ^ CHESS_BITBOARD_SQUARE(from) ^ CHESS_BITBOARD_SQUARE(captured))
+                | CHESS_BITBOARD_SQUARE(ep);
+            if (!attackers_of(position, king, other, blockers))
+                ADD_MOVE(chess_move_make(from, ep));
         }
     }
 
-    return 0;
+    if (checkers)
+        return n;
+
+    if (castle_path_is_safe(position, (color == CHESS_COLOR_WHITE) ? CHESS_SQUARE_G1 : CHESS_SQUARE_G8))
+        ADD_MOVE(chess_move_make(king, king + 2));
+    if (castle_path_is_safe(position, (color == CHESS_COLOR_WHITE) ? CHESS_SQUARE_C1 : CHESS_SQUARE_C8))
+        ADD_MOVE(chess_move_make(king, king - 2));
+
+    return n;
+}
+
+void chess_move_generator_init(ChessMoveGenerator* gen, const ChessPosition* position)
+{
+    gen->position = position;
+    gen->num_moves = chess_generate_moves(position, gen->moves);
+    gen->index = 0;
 }
 
 ChessMove chess_move_generator_next(ChessMoveGenerator* generator)
 {
-    ChessMove move = 0;
-    while ((move = gen_next(generator)) && !move_is_legal(generator->position, move))
-        ;
-    return move;
+    if (generator->index < generator->num_moves)
+        return generator->moves[generator->index++];
+    return 0;
 }
 
-void chess_generate_moves(const ChessPosition* position, ChessArray* moves)
+ChessBoolean chess_generate_is_square_attacked(const ChessPosition* position, ChessSquare sq, ChessColor color)
+{
+    ChessBitboard occupied = position->occupied[CHESS_COLOR_WHITE] | position->occupied[CHESS_COLOR_BLACK];
+    return attackers_of(position, sq, color, occupied) != CHESS_BITBOARD_EMPTY;
+}
+
+ChessBitboard chess_generate_origins(const ChessPosition* position, ChessPiece piece, ChessSquare to)
 {
-    ChessMoveGenerator generator;
-    ChessMove move;
+    ChessColor color = position->to_move;
+    ChessColor other = chess_color_other(color);
+    ChessBitboard occupied = position->occupied[CHESS_COLOR_WHITE] | position->occupied[CHESS_COLOR_BLACK];
+    ChessBitboard pieces = position->bitboards[piece];
+    ChessBitboard origins = CHESS_BITBOARD_EMPTY;
+    ChessRank rank = chess_square_rank(to);
+    ChessSquare ep;
+    int slide;
+
+    assert(chess_piece_color(piece) == color);
 
-    chess_move_generator_init(&generator, position);
+    if (position->occupied[color] & CHESS_BITBOARD_SQUARE(to))
+        return CHESS_BITBOARD_EMPTY;
 
-    while ((move = chess_move_generator_next(&generator)))
+    switch (chess_piece_of_color(piece, CHESS_COLOR_WHITE))
     {
-        if (!move_is_legal(position, move))
-            continue;
+        case CHESS_PIECE_WHITE_KNIGHT:
+            return knight_attacks[to] & pieces;
+        case CHESS_PIECE_WHITE_BISHOP:
+            return BISHOP_ATTACKS(to, occupied) & pieces;
+        case CHESS_PIECE_WHITE_ROOK:
+            return ROOK_ATTACKS(to, occupied) & pieces;
+        case CHESS_PIECE_WHITE_QUEEN:
+            return (BISHOP_ATTACKS(to, occupied) | ROOK_ATTACKS(to, occupied)) & pieces;
+        case CHESS_PIECE_WHITE_KING:
+            origins = king_attacks[to] & pieces;
+            /* Castling is a move of the king, from two squares away */
+            if (chess_square_file(to) == CHESS_FILE_G || chess_square_file(to) == CHESS_FILE_C)
+            {
+                if (rank == ((color == CHESS_COLOR_WHITE) ? CHESS_RANK_1 : CHESS_RANK_8))
+                    origins |= CHESS_BITBOARD_SQUARE(chess_square_from_fr(CHESS_FILE_E, rank)) & pieces;
+            }
+            return origins;
+        case CHESS_PIECE_WHITE_PAWN:
+            break;
+        default:
+            return CHESS_BITBOARD_EMPTY;
+    }
+
+    /* Pawns only reach the ranks ahead of their second */
+    if (rank == ((color == CHESS_COLOR_WHITE) ? CHESS_RANK_1 : CHESS_RANK_8)
+        || rank == ((color == CHESS_COLOR_WHITE) ? CHESS_RANK_2 : CHESS_RANK_7))
+        return CHESS_BITBOARD_EMPTY;
+
+    ep = (position->ep == CHESS_FILE_INVALID) ? CHESS_SQUARE_INVALID
+        : chess_square_from_fr(position->ep, (color == CHESS_COLOR_WHITE) ? CHESS_RANK_6 : CHESS_RANK_3);
+    if ((position->occupied[other] & CHESS_BITBOARD_SQUARE(to)) || to == ep)
+        return pawn_attacks[other][to] & pieces;
+
+    slide = (color == CHESS_COLOR_WHITE) ? SLIDE_N : SLIDE_S;
+    if (pieces & CHESS_BITBOARD_SQUARE(to - slide))
+        return CHESS_BITBOARD_SQUARE(to - slide);
+    if (rank == ((color == CHESS_COLOR_WHITE) ? CHESS_RANK_4 : CHESS_RANK_5)
+        && !(occupied & CHESS_BITBOARD_SQUARE(to - slide)))
+        return pieces & CHESS_BITBOARD_SQUARE(to - 2 * slide);
+    return CHESS_BITBOARD_EMPTY;
+}
+
+ChessBoolean chess_generate_move_is_legal(const ChessPosition* position, ChessMove move)
+{
+    ChessColor color = position->to_move;
+    ChessColor other = chess_color_other(color);
+    ChessBitboard occupied = position->occupied[CHESS_COLOR_WHITE] | position->occupied[CHESS_COLOR_BLACK];
+    ChessSquare king = (color == CHESS_COLOR_WHITE) ? position->wking : position->bking;
+    ChessSquare from = chess_move_from(move), to = chess_move_to(move);
+    ChessBitboard after;
 
-        chess_array_push(moves, &move);
+    if (from == king)
+    {
+        if (to == king + 2 || to == king - 2)
+            return !attackers_of(position, king, other, occupied) && castle_path_is_safe(position, to);
+        return !attackers_of(position, to, other, occupied ^ CHESS_BITBOARD_SQUARE(king));
     }
+
+    after = (occupied ^ CHESS_BITBOARD_SQUARE(from)) | CHESS_BITBOARD_SQUARE(to);
+
+    /* En passant also takes away the pawn beside the one moving */
+    if (position->piece[to] == CHESS_PIECE_NONE
+        && position->piece[from] == chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color)
+        && chess_square_file(from) != chess_square_file(to))
+        after ^= CHESS_BITBOARD_SQUARE(chess_square_from_fr(chess_square_file(to), chess_square_rank(from)));
+
+    /* A piece captured on the destination no longer attacks anything */
+    return !(attackers_of(position, king, other, after) & ~CHESS_BITBOARD_SQUARE(to));
 }
 
-ChessBoolean chess_generate_is_square_attacked(const ChessPosition* position, ChessSquare sq, ChessColor color)
+ChessBoolean chess_generate_has_legal_move(const ChessPosition* position)
 {
-    ChessSquare from;
+    ChessColor color = position->to_move;
+    ChessColor other = chess_color_other(color);
+    ChessBitboard occupied = position->occupied[CHESS_COLOR_WHITE] | position->occupied[CHESS_COLOR_BLACK];
+    ChessSquare king = (color == CHESS_COLOR_WHITE) ? position->wking : position->bking;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    ChessBitboard checkers, targets, attacks, origins;
+    ChessSquare to, ep;
     ChessPiece piece;
-    int dirs, dir, d, dist;
 
-    /* Check for knight attacks */
-    dirs = jump_dirs[sq];
-    for (d = 0; d < 8; d++)
+    /* The king can usually step somewhere */
+    attacks = king_attacks[king] & ~position->occupied[color];
+    while (attacks)
     {
-        dir = dirs_array[d];
-        if ((dir & dirs) == 0)
-            continue;
-
-        from = sq + jumps_array[d];
-        piece = position->piece[from];
-        if (position->piece[from] == chess_piece_of_color(CHESS_PIECE_WHITE_KNIGHT, color))
+        if (!attackers_of(position, chess_bitboard_pop(&attacks), other, occupied ^ CHESS_BITBOARD_SQUARE(king)))
             return CHESS_TRUE;
     }
 
-    for (d = 0; d < 8; d++)
+    checkers = attackers_of(position, king, other, occupied);
+    if (!checkers)
+        return chess_generate_moves(position, moves) > 0;
+    if (CHESS_BITBOARD_COUNT(checkers) > 1)
+        return CHESS_FALSE;
+
+    /* Otherwise only the squares that capture the checker or block it */
+    targets = checkers | between[king][CHESS_BITBOARD_LSB(checkers)];
+    if (position->ep != CHESS_FILE_INVALID)
     {
-        dir = dirs_array[d];
-        from = sq;
-        dist = 1;
+        ep = chess_square_from_fr(position->ep, (color == CHESS_COLOR_WHITE) ? CHESS_RANK_6 : CHESS_RANK_3);
+        if (checkers & CHESS_BITBOARD_SQUARE(ep + ((color == CHESS_COLOR_WHITE) ? SLIDE_S : SLIDE_N)))
+            targets |= CHESS_BITBOARD_SQUARE(ep);
+    }
 
-        do
+    while (targets)
+    {
+        to = chess_bitboard_pop(&targets);
+        for (piece = chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color); piece < CHESS_PIECE_WHITE_KING; piece += 2)
         {
-            dirs = slide_dirs[from];
-            if ((dir & dirs) == 0)
-                break;
-
-            from += slides_array[d];
-            piece = position->piece[from];
-            if (piece != CHESS_PIECE_NONE && chess_piece_color(piece) == color)
+            origins = chess_generate_origins(position, piece, to);
+            while (origins)
             {
-                switch (piece)
-                {
-                    case CHESS_PIECE_WHITE_QUEEN:
-                    case CHESS_PIECE_BLACK_QUEEN:
-                        return CHESS_TRUE;
-                    case CHESS_PIECE_WHITE_BISHOP:
-                    case CHESS_PIECE_BLACK_BISHOP:
-                        if (dir & bishop_dirs)
-                            return CHESS_TRUE;
-                        break;
-                    case CHESS_PIECE_WHITE_ROOK:
-                    case CHESS_PIECE_BLACK_ROOK:
-                        if (dir & rook_dirs)
-                            return CHESS_TRUE;
-                        break;
-                    case CHESS_PIECE_WHITE_KING:
-                    case CHESS_PIECE_BLACK_KING:
-                        if (dist == 1)
-                            return CHESS_TRUE;
-                        break;
-                    case CHESS_PIECE_WHITE_PAWN:
-                        if (dist == 1 && dir & (DIR_SE | DIR_SW))
-                            return CHESS_TRUE;
-                        break;
-                    case CHESS_PIECE_BLACK_PAWN:
-                        if (dist == 1 && dir & (DIR_NE | DIR_NW))
-                            return CHESS_TRUE;
-                        break;
-                    case CHESS_PIECE_WHITE_KNIGHT:
-                    case CHESS_PIECE_BLACK_KNIGHT:
-                        break;
-                    default:
-                        assert(CHESS_FALSE);
-                        break;
-                }
+                if (chess_generate_move_is_legal(position, chess_move_make(chess_bitboard_pop(&origins), to)))
+                    return CHESS_TRUE;
             }
-            dist++;
-        } while (piece == CHESS_PIECE_NONE);
+        }
     }
-
     return CHESS_FALSE;
 }
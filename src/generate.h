@@ -1,18 +1,22 @@
 #ifndef CHESSLIB_GENERATE_H_
 #define CHESSLIB_GENERATE_H_
 
+#include <stddef.h>
+
 #include "chess.h"
 #include "position.h"
-#include "carray.h"
 
+/* No position reachable in a game has more legal moves than this */
+#define CHESS_GENERATE_MAX_MOVES 218
+
+/* The legal moves are all generated on init, so the position must not
+ * change while the generator is in use */
 typedef struct
 {
     const ChessPosition* position;
-    ChessSquare sq;
-    ChessSquare to;
-    int d;
-    ChessMovePromote promote;
-    ChessCastleState castle;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
+    size_t index;
 } ChessMoveGenerator;
 
 void chess_generate_init(void);
@@ -20,7 +24,22 @@ void chess_generate_init(void);
 void chess_move_generator_init(ChessMoveGenerator*, const ChessPosition*);
 ChessMove chess_move_generator_next(ChessMoveGenerator*);
 
-void chess_generate_moves(const ChessPosition*, ChessArray*);
+/* Writes the legal moves into an array of at least CHESS_GENERATE_MAX_MOVES
+ * and returns the number written */
+size_t chess_generate_moves(const ChessPosition*, ChessMove*);
 ChessBoolean chess_generate_is_square_attacked(const ChessPosition*, ChessSquare, ChessColor);
 
+/* The squares from which the side to move's pieces of the given kind (which
+ * must be of that side's color) could move to sq, as far as the board's
+ * geometry allows. Pins and check are not considered, nor what is crossed by
+ * castling, which is counted as a move of the king to the g or c file. */
+ChessBitboard chess_generate_origins(const ChessPosition*, ChessPiece, ChessSquare);
+
+/* Whether a move from chess_generate_origins is legal, including castling */
+ChessBoolean chess_generate_move_is_legal(const ChessPosition*, ChessMove);
+
+/* Stops at the first legal move found, trying the king's first and, in
+ * check, only the moves that capture or block the checker */
+ChessBoolean chess_generate_has_legal_move(const ChessPosition*);
+
 #endif /* CHESSLIB_GENERATE_H_ */
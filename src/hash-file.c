@@ -0,0 +1,265 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "calloc.h"
+#include "hash-file.h"
+
+typedef struct
+{
+    char magic[8];
+    uint64_t num_records;
+} HashFileHeader;
+
+ChessBoolean chess_hash_file_write_header(FILE* file, const char magic[8], uint64_t num_records)
+{
+    HashFileHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.num_records = num_records;
+    return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+static void init_empty(ChessHashFile* file, size_t record_size)
+{
+    file->data = NULL;
+    file->size = 0;
+    file->records = NULL;
+    file->record_size = record_size;
+    file->num_records = 0;
+}
+
+ChessBoolean chess_hash_file_open(ChessHashFile* file, const char* filename,
+    const char magic[8], size_t record_size)
+{
+    const HashFileHeader* header;
+    struct stat st;
+    void* data;
+    int fd;
+
+    init_empty(file, record_size);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return CHESS_FALSE;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(HashFileHeader))
+    {
+        close(fd);
+        return CHESS_FALSE;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return CHESS_FALSE;
+#ifdef MADV_RANDOM
+    madvise(data, (size_t)st.st_size, MADV_RANDOM);
+#endif
+    file->data = data;
+    file->size = (size_t)st.st_size;
+
+    header = (const HashFileHeader*)data;
+    if (memcmp(header->magic, magic, sizeof(header->magic)) != 0
+        || (file->size - sizeof(HashFileHeader)) / record_size != header->num_records)
+    {
+        chess_hash_file_close(file);
+        return CHESS_FALSE;
+    }
+
+    file->records = (const char*)(header + 1);
+    file->num_records = header->num_records;
+    return CHESS_TRUE;
+}
+
+void chess_hash_file_close(ChessHashFile* file)
+{
+    if (file->data != NULL)
+        munmap(file->data, file->size);
+    init_empty(file, file->record_size);
+}
+
+static ChessHash record_hash(const ChessHashFile* file, size_t i)
+{
+    return *(const ChessHash*)(file->records + i * file->record_size);
+}
+
+size_t chess_hash_file_find(const ChessHashFile* file, ChessHash hash, const void** records)
+{
+    size_t low = 0, high = file->num_records, mid, first;
+
+    /* Find the first record with the hash, then the first one after */
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        if (record_hash(file, mid) < hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    first = low;
+
+    high = file->num_records;
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        if (record_hash(file, mid) <= hash)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    *records = file->records + first * file->record_size;
+    return low - first;
+}
+
+void chess_hash_file_runs_init(ChessHashFileRuns* runs, size_t record_size,
+    ChessHashFileCompareFunc compare, ChessHashFileMergeFunc merge)
+{
+    runs->record_size = record_size;
+    runs->compare = compare;
+    runs->merge = merge;
+    chess_array_init(&runs->runs, sizeof(FILE*));
+}
+
+void chess_hash_file_runs_cleanup(ChessHashFileRuns* runs)
+{
+    size_t i;
+
+    for (i = 0; i < chess_array_size(&runs->runs); i++)
+        fclose(*(FILE* const*)chess_array_elem(&runs->runs, i));
+    chess_array_cleanup(&runs->runs);
+}
+
+size_t chess_hash_file_runs_size(const ChessHashFileRuns* runs)
+{
+    return chess_array_size(&runs->runs);
+}
+
+ChessBoolean chess_hash_file_runs_add(ChessHashFileRuns* runs, const void* records, size_t num_records)
+{
+    FILE* file = tmpfile();
+
+    if (file == NULL)
+        return CHESS_FALSE;
+
+    if (fwrite(records, runs->record_size, num_records, file) != num_records)
+    {
+        fclose(file);
+        return CHESS_FALSE;
+    }
+
+    chess_array_push(&runs->runs, &file);
+    return CHESS_TRUE;
+}
+
+/* Reads the next record of a source: a run, or the records in memory after
+ * the runs. Returns CHESS_FALSE at the end. */
+static ChessBoolean read_record(const ChessHashFileRuns* runs, size_t source,
+    const char** records, size_t* num_records, void* record)
+{
+    FILE* const* files = chess_array_data(&runs->runs);
+
+    if (source < chess_array_size(&runs->runs))
+        return fread(record, runs->record_size, 1, files[source]) == 1;
+
+    if (*num_records == 0)
+        return CHESS_FALSE;
+    memcpy(record, *records, runs->record_size);
+    *records += runs->record_size;
+    (*num_records)--;
+    return CHESS_TRUE;
+}
+
+/* Merges the sources into the file. Returns how many records were
+ * written, or (size_t)-1 if writing failed. */
+static size_t merge_runs(ChessHashFileRuns* runs, FILE* file,
+    const char* records, size_t num_records)
+{
+    size_t num_sources = chess_array_size(&runs->runs) + 1, i, best, written = 0;
+    size_t size = runs->record_size;
+    FILE* const* files = chess_array_data(&runs->runs);
+    char* heads, *merged;
+    ChessBoolean* active, have_merged = CHESS_FALSE, ok = CHESS_TRUE;
+
+    heads = chess_alloc(num_sources * size);
+    merged = chess_alloc(size);
+    active = chess_alloc(num_sources * sizeof(ChessBoolean));
+    for (i = 0; i < num_sources; i++)
+    {
+        /* From the start, in case of an earlier save */
+        if (i + 1 < num_sources)
+            rewind(files[i]);
+        active[i] = read_record(runs, i, &records, &num_records, heads + i * size);
+    }
+
+    /* There are only ever a few runs, so a linear scan for the least will do */
+    for (;;)
+    {
+        best = num_sources;
+        for (i = 0; i < num_sources; i++)
+        {
+            if (active[i] && (best == num_sources
+                || runs->compare(heads + i * size, heads + best * size) < 0))
+                best = i;
+        }
+
+        if (have_merged && (best == num_sources || runs->merge == NULL
+            || runs->compare(merged, heads + best * size) != 0))
+        {
+            ok = ok && fwrite(merged, size, 1, file) == 1;
+            written++;
+            have_merged = CHESS_FALSE;
+        }
+        if (best == num_sources)
+            break;
+
+        if (have_merged)
+        {
+            runs->merge(merged, heads + best * size);
+        }
+        else
+        {
+            memcpy(merged, heads + best * size, size);
+            have_merged = CHESS_TRUE;
+        }
+        active[best] = read_record(runs, best, &records, &num_records, heads + best * size);
+    }
+
+    chess_free(heads);
+    chess_free(merged);
+    chess_free(active);
+    return ok ? written : (size_t)-1;
+}
+
+ChessBoolean chess_hash_file_runs_save(ChessHashFileRuns* runs, const char* filename,
+    const char magic[8], const void* records, size_t num_records)
+{
+    ChessBoolean ok;
+    size_t written;
+    FILE* file;
+
+    file = fopen(filename, "wb");
+    if (file == NULL)
+        return CHESS_FALSE;
+
+    if (chess_array_size(&runs->runs) == 0)
+    {
+        /* It all fit in memory */
+        ok = chess_hash_file_write_header(file, magic, num_records)
+            && (num_records == 0
+                || fwrite(records, runs->record_size, num_records, file) == num_records);
+    }
+    else
+    {
+        /* The header is written again once the count is known */
+        ok = chess_hash_file_write_header(file, magic, 0);
+        written = ok ? merge_runs(runs, file, records, num_records) : (size_t)-1;
+        ok = written != (size_t)-1 && fseek(file, 0, SEEK_SET) == 0
+            && chess_hash_file_write_header(file, magic, written);
+    }
+    return (fclose(file) == 0) && ok;
+}
@@ -0,0 +1,70 @@
+#ifndef CHESSLIB_HASH_FILE_H_
+#define CHESSLIB_HASH_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "carray.h"
+#include "chess.h"
+#include "zobrist.h"
+
+/* A file of fixed size records that each start with a ChessHash, sorted by
+ * it. After a header of eight magic bytes and the record count, it's all
+ * in the machine's byte order so it can be searched straight from memory.
+ * The file is mapped for random access, as searches jump around it. */
+
+typedef struct
+{
+    void* data;
+    size_t size;
+    const char* records;
+    size_t record_size;
+    size_t num_records;
+} ChessHashFile;
+
+/* Returns CHESS_FALSE if it couldn't be written */
+ChessBoolean chess_hash_file_write_header(FILE*, const char magic[8], uint64_t num_records);
+
+/* Returns CHESS_FALSE if the file can't be mapped, or doesn't have the
+ * magic bytes and the records its header says */
+ChessBoolean chess_hash_file_open(ChessHashFile*, const char* filename,
+    const char magic[8], size_t record_size);
+void chess_hash_file_close(ChessHashFile*);
+
+/* Points records at those with the hash, in the order they were written,
+ * and returns how many there are */
+size_t chess_hash_file_find(const ChessHashFile*, ChessHash, const void** records);
+
+/* For writing more records than fit in memory: they're sorted a batch at a
+ * time into temporary files, or runs, which are merged into the file when
+ * it's saved. Records that compare equal are combined with the merge
+ * function, or all kept in the order of their runs if it's NULL. */
+typedef int (*ChessHashFileCompareFunc)(const void*, const void*);
+typedef void (*ChessHashFileMergeFunc)(void* to, const void* from);
+
+typedef struct
+{
+    size_t record_size;
+    ChessHashFileCompareFunc compare;
+    ChessHashFileMergeFunc merge;
+    ChessArray runs; /* FILE*s */
+} ChessHashFileRuns;
+
+void chess_hash_file_runs_init(ChessHashFileRuns*, size_t record_size,
+    ChessHashFileCompareFunc, ChessHashFileMergeFunc);
+void chess_hash_file_runs_cleanup(ChessHashFileRuns*);
+size_t chess_hash_file_runs_size(const ChessHashFileRuns*);
+
+/* Writes the records, which must be sorted, to a new run. Returns
+ * CHESS_FALSE if it couldn't. */
+ChessBoolean chess_hash_file_runs_add(ChessHashFileRuns*, const void* records, size_t num_records);
+
+/* Writes the file from the runs and the records, which must be sorted and
+ * not need merging with each other. The runs are only read, so more can be
+ * added and the file saved again. Returns CHESS_FALSE if the file couldn't
+ * be written. */
+ChessBoolean chess_hash_file_runs_save(ChessHashFileRuns*, const char* filename,
+    const char magic[8], const void* records, size_t num_records);
+
+#endif /* CHESSLIB_HASH_FILE_H_ */
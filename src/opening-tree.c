@@ -0,0 +1,265 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "calloc.h"
+#include "opening-tree.h"
+
+/* The moves are sorted by hash and move */
+static const char TREE_MAGIC[8] = { 'C', 'H', 'S', 'O', 1, 0, 0, 0 };
+
+/* The table starts this big and doubles until it reaches the limit, which
+ * is never less than the smallest size */
+#define TREE_MIN_CAPACITY 16
+#define TREE_START_CAPACITY 1024
+
+unsigned int chess_opening_tree_move_average_elo(const ChessOpeningTreeMove* move)
+{
+    return move->elo_games ? (unsigned int)(move->elo_sum / move->elo_games) : 0;
+}
+
+static int compare_moves(const void* a, const void* b)
+{
+    const ChessOpeningTreeMove* x = a, *y = b;
+
+    if (x->hash != y->hash)
+        return (x->hash < y->hash) ? -1 : 1;
+    if (x->move != y->move)
+        return (x->move < y->move) ? -1 : 1;
+    return 0;
+}
+
+static void merge_move(void* a, const void* b)
+{
+    ChessOpeningTreeMove* to = a;
+    const ChessOpeningTreeMove* from = b;
+
+    to->games += from->games;
+    to->white_wins += from->white_wins;
+    to->draws += from->draws;
+    to->black_wins += from->black_wins;
+    to->elo_games += from->elo_games;
+    to->elo_sum += from->elo_sum;
+}
+
+static void alloc_table(ChessOpeningTreeBuilder* builder, size_t capacity)
+{
+    builder->capacity = capacity;
+    builder->table = chess_alloc(capacity * sizeof(ChessOpeningTreeMove));
+    memset(builder->table, 0, capacity * sizeof(ChessOpeningTreeMove));
+}
+
+void chess_opening_tree_builder_init(ChessOpeningTreeBuilder* builder, size_t max_memory, size_t max_ply)
+{
+    size_t max_capacity = TREE_MIN_CAPACITY;
+
+    /* Capacities are powers of two */
+    while (max_capacity * 2 * sizeof(ChessOpeningTreeMove) <= max_memory)
+        max_capacity *= 2;
+
+    builder->max_capacity = max_capacity;
+    builder->max_ply = max_ply;
+    builder->size = 0;
+    alloc_table(builder, (max_capacity < TREE_START_CAPACITY) ? max_capacity : TREE_START_CAPACITY);
+    chess_hash_file_runs_init(&builder->runs, sizeof(ChessOpeningTreeMove),
+        compare_moves, merge_move);
+}
+
+void chess_opening_tree_builder_cleanup(ChessOpeningTreeBuilder* builder)
+{
+    chess_hash_file_runs_cleanup(&builder->runs);
+    chess_free(builder->table);
+}
+
+static size_t table_slot(const ChessOpeningTreeBuilder* builder, ChessHash hash, uint32_t move)
+{
+    /* Zobrist keys are random already, the move just needs mixing in */
+    ChessHash mix = ((ChessHash)0x9e3779b9 << 32) | 0x7f4a7c15;
+    return (size_t)((hash ^ (move * mix)) & (builder->capacity - 1));
+}
+
+static ChessOpeningTreeMove* find_slot(ChessOpeningTreeBuilder* builder, ChessHash hash, uint32_t move)
+{
+    size_t slot = table_slot(builder, hash, move);
+    ChessOpeningTreeMove* entry;
+
+    for (;;)
+    {
+        entry = &builder->table[slot];
+        if (entry->games == 0 || (entry->hash == hash && entry->move == move))
+            return entry;
+        slot = (slot + 1) & (builder->capacity - 1);
+    }
+}
+
+static void grow_table(ChessOpeningTreeBuilder* builder)
+{
+    ChessOpeningTreeMove* old = builder->table, *entry;
+    size_t old_capacity = builder->capacity, i;
+
+    alloc_table(builder, old_capacity * 2);
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (old[i].games == 0)
+            continue;
+        entry = find_slot(builder, old[i].hash, old[i].move);
+        memcpy(entry, &old[i], sizeof(ChessOpeningTreeMove));
+    }
+    chess_free(old);
+}
+
+/* Gathers the moves from the table into the array in sorted order. Spills
+ * pass the table itself, as it's cleared afterwards anyway. */
+static void sort_table(ChessOpeningTreeBuilder* builder, ChessOpeningTreeMove* moves)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < builder->capacity; i++)
+    {
+        if (builder->table[i].games == 0)
+            continue;
+        if (&moves[n] != &builder->table[i])
+            memcpy(&moves[n], &builder->table[i], sizeof(ChessOpeningTreeMove));
+        n++;
+    }
+    assert(n == builder->size);
+    qsort(moves, n, sizeof(ChessOpeningTreeMove), compare_moves);
+}
+
+static ChessBoolean spill_table(ChessOpeningTreeBuilder* builder)
+{
+    sort_table(builder, builder->table);
+    if (!chess_hash_file_runs_add(&builder->runs, builder->table, builder->size))
+        return CHESS_FALSE;
+
+    memset(builder->table, 0, builder->capacity * sizeof(ChessOpeningTreeMove));
+    builder->size = 0;
+    return CHESS_TRUE;
+}
+
+static void add_move(ChessOpeningTreeBuilder* builder, ChessHash hash, ChessMove move,
+    ChessResult result, unsigned int elo)
+{
+    ChessOpeningTreeMove* entry = find_slot(builder, hash, (uint32_t)move);
+
+    if (entry->games == 0)
+    {
+        memset(entry, 0, sizeof(ChessOpeningTreeMove));
+        entry->hash = hash;
+        entry->move = (uint32_t)move;
+        builder->size++;
+    }
+
+    entry->games++;
+    entry->white_wins += (result == CHESS_RESULT_WHITE_WINS);
+    entry->draws += (result == CHESS_RESULT_DRAW);
+    entry->black_wins += (result == CHESS_RESULT_BLACK_WINS);
+    if (elo > 0)
+    {
+        entry->elo_games++;
+        entry->elo_sum += elo;
+    }
+
+    /* Keep the table under three quarters full. Past the limit it goes to
+     * disk, unless that fails, when there's no choice but to keep growing. */
+    if (builder->size * 4 > builder->capacity * 3)
+    {
+        if (builder->capacity < builder->max_capacity || !spill_table(builder))
+            grow_table(builder);
+    }
+}
+
+static unsigned int tag_elo(ChessGame* game, const char* name)
+{
+    const char* value = chess_game_tag_value(game, name);
+    int elo = value ? atoi(value) : 0;
+    return (elo > 0) ? (unsigned int)elo : 0;
+}
+
+ChessBoolean chess_opening_tree_builder_add_game(ChessOpeningTreeBuilder* builder, ChessGame* game)
+{
+    ChessPosition position;
+    ChessResult result = chess_game_result(game);
+    unsigned int white_elo = tag_elo(game, "WhiteElo");
+    unsigned int black_elo = tag_elo(game, "BlackElo");
+    size_t ply, i;
+    ChessMove move;
+
+    if (!chess_game_load_moves(game))
+        return CHESS_FALSE;
+
+    ply = chess_game_ply(game);
+    if (builder->max_ply > 0 && ply > builder->max_ply)
+        ply = builder->max_ply;
+
+    chess_position_copy(chess_game_initial_position(game), &position);
+    for (i = 0; i < ply; i++)
+    {
+        move = chess_game_move_at_ply(game, i);
+        add_move(builder, chess_position_hash(&position), move, result,
+            (position.to_move == CHESS_COLOR_WHITE) ? white_elo : black_elo);
+        chess_position_make_move(&position, move);
+    }
+    return CHESS_TRUE;
+}
+
+size_t chess_opening_tree_builder_add_pgn(ChessOpeningTreeBuilder* builder, ChessPgnLoader* loader)
+{
+    ChessGame* game = chess_game_new();
+    ChessPgnLoadResult result;
+    size_t count = 0;
+
+    while ((result = chess_pgn_loader_next(loader, game)) != CHESS_PGN_LOAD_EOF)
+    {
+        if (result == CHESS_PGN_LOAD_OK && chess_opening_tree_builder_add_game(builder, game))
+            count++;
+    }
+    chess_game_destroy(game);
+    return count;
+}
+
+ChessBoolean chess_opening_tree_builder_save(ChessOpeningTreeBuilder* builder, const char* filename)
+{
+    ChessOpeningTreeMove* moves;
+    ChessBoolean ok;
+
+    if (chess_hash_file_runs_size(&builder->runs) > 0)
+    {
+        /* The table joins the runs rather than being copied, to keep to
+         * the memory limit */
+        return (builder->size == 0 || spill_table(builder))
+            && chess_hash_file_runs_save(&builder->runs, filename, TREE_MAGIC, NULL, 0);
+    }
+
+    /* A sorted copy is written so the table can still be added to */
+    moves = chess_alloc(builder->size * sizeof(ChessOpeningTreeMove));
+    sort_table(builder, moves);
+    ok = chess_hash_file_runs_save(&builder->runs, filename, TREE_MAGIC, moves, builder->size);
+    chess_free(moves);
+    return ok;
+}
+
+ChessBoolean chess_opening_tree_init(ChessOpeningTree* tree, const char* filename)
+{
+    ChessBoolean ok = chess_hash_file_open(&tree->file, filename,
+        TREE_MAGIC, sizeof(ChessOpeningTreeMove));
+
+    tree->moves = (const ChessOpeningTreeMove*)tree->file.records;
+    tree->num_moves = tree->file.num_records;
+    return ok;
+}
+
+void chess_opening_tree_cleanup(ChessOpeningTree* tree)
+{
+    chess_hash_file_close(&tree->file);
+}
+
+size_t chess_opening_tree_find(const ChessOpeningTree* tree, ChessHash hash,
+    const ChessOpeningTreeMove** moves)
+{
+    const void* records;
+    size_t count = chess_hash_file_find(&tree->file, hash, &records);
+
+    *moves = records;
+    return count;
+}
@@ -0,0 +1,68 @@
+#ifndef CHESSLIB_OPENING_TREE_H_
+#define CHESSLIB_OPENING_TREE_H_
+
+#include <stdint.h>
+
+#include "game.h"
+#include "hash-file.h"
+#include "pgn.h"
+#include "zobrist.h"
+
+/* Statistics for the moves played from each position in a set of games,
+ * built in bounded memory and saved to a file that is searched in place. */
+
+typedef struct
+{
+    ChessHash hash; /* of the position the move is played from */
+    uint32_t move;
+    uint32_t games;
+    uint32_t white_wins, draws, black_wins;
+    uint32_t elo_games; /* games where the mover's Elo was known */
+    uint64_t elo_sum;
+} ChessOpeningTreeMove;
+
+/* Returns 0 if no Elo was known */
+unsigned int chess_opening_tree_move_average_elo(const ChessOpeningTreeMove*);
+
+typedef struct
+{
+    ChessOpeningTreeMove* table;
+    size_t capacity, size;
+    size_t max_capacity;
+    size_t max_ply;
+    ChessHashFileRuns runs; /* moves spilled from the table */
+} ChessOpeningTreeBuilder;
+
+/* Once the table would take more than max_memory bytes, it's written out to
+ * temporary files, which are merged when saving. Only the first max_ply
+ * moves of each game are counted, or all of them if 0. */
+void chess_opening_tree_builder_init(ChessOpeningTreeBuilder*, size_t max_memory, size_t max_ply);
+void chess_opening_tree_builder_cleanup(ChessOpeningTreeBuilder*);
+
+/* Counts the moves of the game's mainline, loading any deferred moves first.
+ * Returns CHESS_FALSE, counting nothing, if they don't all load. */
+ChessBoolean chess_opening_tree_builder_add_game(ChessOpeningTreeBuilder*, ChessGame*);
+/* Adds all the games left in the loader that load. Returns how many. */
+size_t chess_opening_tree_builder_add_pgn(ChessOpeningTreeBuilder*, ChessPgnLoader*);
+
+/* Returns CHESS_FALSE if the file couldn't be written. The builder can be
+ * added to and saved again afterwards. */
+ChessBoolean chess_opening_tree_builder_save(ChessOpeningTreeBuilder*, const char* filename);
+
+typedef struct
+{
+    ChessHashFile file;
+    const ChessOpeningTreeMove* moves;
+    size_t num_moves;
+} ChessOpeningTree;
+
+/* Returns CHESS_FALSE if the file can't be mapped or isn't a tree */
+ChessBoolean chess_opening_tree_init(ChessOpeningTree*, const char* filename);
+void chess_opening_tree_cleanup(ChessOpeningTree*);
+
+/* Points moves at those played from the position with the hash, in order
+ * of ChessMove, and returns how many there are */
+size_t chess_opening_tree_find(const ChessOpeningTree*, ChessHash,
+    const ChessOpeningTreeMove** moves);
+
+#endif /* CHESSLIB_OPENING_TREE_H_ */
@@ -9,6 +9,10 @@
 #include "parse.h"
 #include "generate.h"
 #include "carray.h"
+#include "bitboard.h"
+
+#define FILE_A_SQUARES ((ChessBitboard)0x01010101 << 32 | 0x01010101)
+#define RANK_1_SQUARES ((ChessBitboard)0xff)
 
 static ChessBoolean matches_move(const ChessPosition* position, ChessMove move,
     char piece, char from_file, char from_rank, char capture, char to_file, char to_rank, char promote)
@@ -51,6 +55,80 @@ static ChessBoolean matches_move(const ChessPosition* position, ChessMove move,
     return CHESS_TRUE;
 }
 
+/* Counts the legal moves to sq by the piece from the origins, setting move
+ * to the last one. A pawn reaching the last rank without a promotion piece
+ * could promote to any of four. */
+static int count_moves(const ChessPosition* position, ChessPiece piece, ChessBitboard origins,
+    ChessSquare to, char promote, ChessMove* move)
+{
+    ChessBoolean promotes = (piece == CHESS_PIECE_WHITE_PAWN || piece == CHESS_PIECE_BLACK_PAWN)
+        && (chess_square_rank(to) == CHESS_RANK_1 || chess_square_rank(to) == CHESS_RANK_8);
+    ChessMovePromote promote_to = promote ? chess_move_promote_from_char(promote) : CHESS_MOVE_PROMOTE_QUEEN;
+    ChessMove m;
+    int n = 0;
+
+    if (promote && (!promotes || promote_to == CHESS_MOVE_PROMOTE_NONE))
+        return 0;
+
+    while (origins)
+    {
+        m = promotes ? chess_move_make_promote(chess_bitboard_pop(&origins), to, promote_to)
+            : chess_move_make(chess_bitboard_pop(&origins), to);
+        if (chess_generate_move_is_legal(position, m))
+        {
+            n += (promotes && !promote) ? 4 : 1;
+            *move = m;
+        }
+    }
+    return n;
+}
+
+/* Resolves a move to a known square by looking back from it for the pieces
+ * that can reach it, and only testing those for legality */
+static ChessParseMoveResult resolve_move(const ChessPosition* position, char piece,
+    char from_file, char from_rank, char capture, ChessSquare to, char promote, ChessMove* ret_move)
+{
+    ChessColor color = position->to_move;
+    ChessBitboard mask = CHESS_BITBOARD_FULL;
+    ChessPiece pc;
+    ChessMove move = 0;
+    int n;
+
+    /* Whether it captures only depends on where it goes */
+    if (capture && !chess_position_move_is_capture(position, chess_move_make(to, to)))
+        return CHESS_PARSE_MOVE_ILLEGAL;
+
+    if (from_file)
+        mask &= FILE_A_SQUARES << chess_file_from_char(from_file);
+    if (from_rank)
+        mask &= RANK_1_SQUARES << (8 * chess_rank_from_char(from_rank));
+
+    if (piece)
+    {
+        pc = chess_piece_of_color(chess_piece_from_char(piece), color);
+        n = count_moves(position, pc, chess_generate_origins(position, pc, to) & mask, to, promote, &move);
+    }
+    else
+    {
+        /* Pawn moves come first; any other piece will do if there are none */
+        pc = chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color);
+        n = count_moves(position, pc, chess_generate_origins(position, pc, to) & mask, to, promote, &move);
+        if (n == 0)
+        {
+            for (pc = chess_piece_of_color(CHESS_PIECE_WHITE_KNIGHT, color); pc <= CHESS_PIECE_BLACK_KING; pc += 2)
+                n += count_moves(position, pc, chess_generate_origins(position, pc, to) & mask, to, promote, &move);
+        }
+    }
+
+    if (n == 0)
+        return CHESS_PARSE_MOVE_ILLEGAL;
+    if (n > 1)
+        return CHESS_PARSE_MOVE_AMBIGUOUS;
+
+    *ret_move = move;
+    return CHESS_PARSE_MOVE_OK;
+}
+
 ChessParseMoveResult chess_parse_move(const char* s, const ChessPosition* position, ChessMove* ret_move)
 {
     char piece = '\0';
@@ -77,6 +155,7 @@ ChessParseMoveResult chess_parse_move(const char* s, const ChessPosition* positi
         piece = 'k';
         from_file = 'e';
         to_file = 'c';
+        to_rank = (position->to_move == CHESS_COLOR_WHITE) ? '1' : '8';
         s += 5;
     }
     else if (!strncasecmp(s, "o-o", 3))
@@ -84,6 +163,7 @@ ChessParseMoveResult chess_parse_move(const char* s, const ChessPosition* positi
         piece = 'k';
         from_file = 'e';
         to_file = 'g';
+        to_rank = (position->to_move == CHESS_COLOR_WHITE) ? '1' : '8';
         s += 3;
     }
     else
@@ -153,6 +233,14 @@ ChessParseMoveResult chess_parse_move(const char* s, const ChessPosition* positi
         from_rank = 0;
     }
 
+    if (to_file && to_rank)
+    {
+        return resolve_move(position, piece, from_file, from_rank, capture,
+            chess_square_from_fr(chess_file_from_char(to_file), chess_rank_from_char(to_rank)),
+            promote, ret_move);
+    }
+
+    /* Without a whole square to look back from, every legal move is tried */
     chess_move_generator_init(&generator, position);
     move = 0;
     piece_move = 0;
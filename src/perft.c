@@ -0,0 +1,156 @@
+#include <assert.h>
+#include <pthread.h>
+
+#include "perft.h"
+#include "calloc.h"
+#include "generate.h"
+
+/* Enough subtrees per thread that one slow subtree doesn't leave the
+ * others idle at the end */
+#define PERFT_WORK_PER_THREAD 16
+#define PERFT_MAX_SPLIT_PLIES 3
+
+typedef struct
+{
+    ChessPosition position;
+    int depth;
+    uint64_t nodes;
+} PerftWork;
+
+typedef struct
+{
+    PerftWork* work;
+    size_t num_work;
+    size_t next;
+    pthread_mutex_t mutex;
+} PerftQueue;
+
+uint64_t chess_perft(ChessPosition* position, int depth)
+{
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves, i;
+    ChessUnmove unmove;
+    uint64_t nodes = 0;
+
+    if (depth <= 0)
+        return 1;
+
+    /* The moves themselves are the leaves, no need to play them */
+    num_moves = chess_generate_moves(position, moves);
+    if (depth == 1)
+        return num_moves;
+
+    for (i = 0; i < num_moves; i++)
+    {
+        unmove = chess_position_make_move(position, moves[i]);
+        nodes += chess_perft(position, depth - 1);
+        chess_position_undo_move(position, unmove);
+    }
+    return nodes;
+}
+
+size_t chess_perft_divide(ChessPosition* position, int depth, ChessMove* moves, uint64_t* nodes)
+{
+    size_t num_moves, i;
+    ChessUnmove unmove;
+
+    assert(depth > 0);
+
+    num_moves = chess_generate_moves(position, moves);
+    for (i = 0; i < num_moves; i++)
+    {
+        unmove = chess_position_make_move(position, moves[i]);
+        nodes[i] = chess_perft(position, depth - 1);
+        chess_position_undo_move(position, unmove);
+    }
+    return num_moves;
+}
+
+static void split_work(ChessPosition* position, int depth, int plies, PerftWork* work, size_t* num_work)
+{
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves, i;
+    ChessUnmove unmove;
+
+    if (plies == 0)
+    {
+        chess_position_copy(position, &work[*num_work].position);
+        work[*num_work].depth = depth;
+        work[*num_work].nodes = 0;
+        (*num_work)++;
+        return;
+    }
+
+    num_moves = chess_generate_moves(position, moves);
+    for (i = 0; i < num_moves; i++)
+    {
+        unmove = chess_position_make_move(position, moves[i]);
+        split_work(position, depth - 1, plies - 1, work, num_work);
+        chess_position_undo_move(position, unmove);
+    }
+}
+
+static void* perft_worker(void* data)
+{
+    PerftQueue* queue = (PerftQueue*)data;
+    PerftWork* work;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        work = (queue->next < queue->num_work) ? &queue->work[queue->next++] : NULL;
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (work == NULL)
+            break;
+        work->nodes = chess_perft(&work->position, work->depth);
+    }
+    return NULL;
+}
+
+uint64_t chess_perft_parallel(ChessPosition* position, int depth, int threads)
+{
+    PerftQueue queue;
+    pthread_t* workers;
+    uint64_t nodes = 0, subtrees;
+    int plies, num_workers, t;
+    size_t i;
+
+    if (threads <= 1 || depth < 3)
+        return chess_perft(position, depth);
+
+    /* Split deeper when there are too few root moves to go round */
+    plies = 1;
+    subtrees = chess_perft(position, plies);
+    while (subtrees < (uint64_t)threads * PERFT_WORK_PER_THREAD
+        && plies < PERFT_MAX_SPLIT_PLIES && plies < depth - 2)
+    {
+        subtrees = chess_perft(position, ++plies);
+    }
+
+    queue.work = chess_alloc(subtrees * sizeof(PerftWork));
+    queue.num_work = 0;
+    queue.next = 0;
+    pthread_mutex_init(&queue.mutex, NULL);
+    split_work(position, depth, plies, queue.work, &queue.num_work);
+    assert(queue.num_work == subtrees);
+
+    /* Whatever threads can't be started, the rest share the work */
+    workers = chess_alloc((threads - 1) * sizeof(pthread_t));
+    for (num_workers = 0; num_workers < threads - 1; num_workers++)
+    {
+        if (pthread_create(&workers[num_workers], NULL, perft_worker, &queue) != 0)
+            break;
+    }
+    perft_worker(&queue);
+    for (t = 0; t < num_workers; t++)
+        pthread_join(workers[t], NULL);
+
+    for (i = 0; i < queue.num_work; i++)
+        nodes += queue.work[i].nodes;
+
+    pthread_mutex_destroy(&queue.mutex);
+    chess_free(workers);
+    chess_free(queue.work);
+    return nodes;
+}
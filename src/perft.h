@@ -0,0 +1,24 @@
+#ifndef CHESSLIB_PERFT_H_
+#define CHESSLIB_PERFT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chess.h"
+#include "position.h"
+
+/* Counts the leaf nodes of the legal move tree to the given depth. The
+ * position is played through and left as it was found. */
+uint64_t chess_perft(ChessPosition*, int depth);
+
+/* As above, but also writes each legal move at the root and the nodes below
+ * it into arrays of at least CHESS_GENERATE_MAX_MOVES. Returns the number of
+ * root moves. */
+size_t chess_perft_divide(ChessPosition*, int depth, ChessMove* moves, uint64_t* nodes);
+
+/* Counts the same nodes as chess_perft, sharing the subtrees a ply or two
+ * below the root between the given number of threads. The calling thread
+ * is one of them. */
+uint64_t chess_perft_parallel(ChessPosition*, int depth, int threads);
+
+#endif /* CHESSLIB_PERFT_H_ */
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "../fen.h"
+#include "../generate.h"
+#include "../perft.h"
+#include "../print.h"
+
+typedef struct
+{
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+} PerftTest;
+
+/* The usual positions from the chess programming wiki */
+static const PerftTest suite[] = {
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609 },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083 },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292 },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+    { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+};
+
+/* Wall clock time, since the CPU time of all threads would hide any gain */
+static double now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void print_speed(uint64_t nodes, double seconds)
+{
+    printf("Nodes: %lu, time: %.3fs", (unsigned long)nodes, seconds);
+    if (seconds > 0)
+        printf(", nps: %.0f", nodes / seconds);
+    printf("\n");
+}
+
+static int run_suite(int threads)
+{
+    ChessPosition position;
+    uint64_t nodes, total_nodes = 0;
+    double start, seconds, total_seconds = 0;
+    size_t i;
+    int failures = 0;
+
+    for (i = 0; i < sizeof(suite) / sizeof(suite[0]); i++)
+    {
+        chess_fen_load(suite[i].fen, &position);
+        start = now();
+        nodes = chess_perft_parallel(&position, suite[i].depth, threads);
+        seconds = now() - start;
+        total_nodes += nodes;
+        total_seconds += seconds;
+
+        printf("%s %s depth %d: %lu", (nodes == suite[i].nodes) ? "ok  " : "FAIL",
+            suite[i].fen, suite[i].depth, (unsigned long)nodes);
+        if (nodes != suite[i].nodes)
+        {
+            printf(" (expected %lu)", (unsigned long)suite[i].nodes);
+            failures++;
+        }
+        printf("\n");
+    }
+
+    print_speed(total_nodes, total_seconds);
+    return failures;
+}
+
+static void run_divide(ChessPosition* position, int depth, int threads)
+{
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    uint64_t nodes, total_nodes = 0;
+    ChessUnmove unmove;
+    char buf[10];
+    size_t num_moves, i;
+    double start = now();
+
+    num_moves = chess_generate_moves(position, moves);
+    for (i = 0; i < num_moves; i++)
+    {
+        unmove = chess_position_make_move(position, moves[i]);
+        nodes = chess_perft_parallel(position, depth - 1, threads);
+        chess_position_undo_move(position, unmove);
+
+        chess_print_move(moves[i], buf);
+        printf("%s: %lu\n", buf, (unsigned long)nodes);
+        total_nodes += nodes;
+    }
+    printf("Moves: %lu\n", (unsigned long)num_moves);
+    print_speed(total_nodes, now() - start);
+}
+
+static void usage(void)
+{
+    fputs("usage: chess-perft [-t threads]                   run the standard suite\n"
+          "       chess-perft [-t threads] [-d] depth [fen]  count the nodes below a position\n"
+          "  -t  number of threads, defaults to the number of cores\n"
+          "  -d  divide: print the nodes below each root move\n", stderr);
+}
+
+int main(int argc, const char* argv[])
+{
+    ChessPosition position;
+    ChessBoolean divide = CHESS_FALSE;
+    const char* fen = CHESS_FEN_STARTING_POSITION;
+    double start;
+    uint64_t nodes;
+    int depth, threads, arg = 1;
+
+    chess_generate_init();
+
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (!strcmp(argv[arg], "-d"))
+        {
+            divide = CHESS_TRUE;
+        }
+        else if (!strcmp(argv[arg], "-t") && arg + 1 < argc && (threads = atoi(argv[arg + 1])) > 0)
+        {
+            arg++;
+        }
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (arg == argc && !divide)
+        return run_suite(threads) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    if (arg >= argc || (depth = atoi(argv[arg])) <= 0)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (++arg < argc)
+        fen = argv[arg];
+
+    if (!chess_fen_load(fen, &position))
+    {
+        fprintf(stderr, "Invalid FEN: %s\n", fen);
+        return EXIT_FAILURE;
+    }
+
+    if (divide)
+    {
+        run_divide(&position, depth, threads);
+    }
+    else
+    {
+        start = now();
+        nodes = chess_perft_parallel(&position, depth, threads);
+        print_speed(nodes, now() - start);
+    }
+    return EXIT_SUCCESS;
+}
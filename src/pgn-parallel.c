@@ -0,0 +1,346 @@
+#include <assert.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "calloc.h"
+#include "pgn-parallel.h"
+#include "reader.h"
+
+/* Games are handed out to the threads this many at a time */
+#define PGN_GAMES_PER_CHUNK 64
+
+typedef struct
+{
+    ChessPgnLoadResult result;
+    ChessGame* game;
+} PgnLoaded;
+
+typedef struct
+{
+    const char* data;
+    size_t size;
+    const size_t* starts;
+    size_t num_games;
+    size_t num_chunks;
+    ChessBoolean ordered;
+    ChessPgnGameFunc func;
+    void* func_data;
+
+    /* Everything below is guarded by the mutex */
+    pthread_mutex_t mutex;
+    pthread_cond_t turn;
+    size_t next_chunk;
+    size_t next_delivery;
+    size_t delivered;
+    ChessBoolean stopped;
+} PgnQueue;
+
+typedef struct
+{
+    const ChessGame* const* games;
+    size_t num_games;
+    size_t num_chunks;
+    ChessWriter* writer;
+
+    /* Everything below is guarded by the mutex */
+    pthread_mutex_t mutex;
+    pthread_cond_t turn;
+    size_t next_chunk;
+    size_t next_delivery;
+} PgnSaveQueue;
+
+void chess_pgn_find_games(const char* data, size_t size, ChessArray* starts)
+{
+    const char* p = data, *end = data + size, *eol, *q;
+    ChessBoolean in_comment = CHESS_FALSE, in_tags = CHESS_FALSE;
+    size_t offset;
+
+    for (; p < end; p = (eol < end) ? eol + 1 : end)
+    {
+        eol = memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+
+        if (!in_comment)
+        {
+            for (q = p; q < eol && isspace((unsigned char)*q); q++)
+                ;
+            if (q < eol && *q == '[')
+            {
+                /* Tag line, and the first one after movetext starts a game */
+                if (!in_tags)
+                {
+                    offset = q - data;
+                    chess_array_push(starts, &offset);
+                    in_tags = CHESS_TRUE;
+                }
+                continue;
+            }
+            if (q < eol)
+                in_tags = CHESS_FALSE;
+        }
+
+        /* Movetext, where only the comments matter */
+        for (q = p; q < eol; q++)
+        {
+            if (in_comment)
+                in_comment = (*q != '}');
+            else
+                in_comment = (*q == '{');
+        }
+    }
+}
+
+/* Must be called with the mutex held */
+static void deliver(PgnQueue* queue, size_t index, const PgnLoaded* loaded)
+{
+    if (queue->stopped)
+        return;
+
+    queue->delivered++;
+    if (!queue->func(queue->func_data, index, loaded->result, loaded->game))
+    {
+        queue->stopped = CHESS_TRUE;
+        pthread_cond_broadcast(&queue->turn);
+    }
+}
+
+/* Loads the game between two starts. The starts come from a quick scan
+ * that can disagree with the loader on odd input, finding no game or more
+ * than one there, which is reported as an error for that game rather than
+ * letting the games after it shift to the wrong index. */
+static ChessPgnLoadResult load_game(PgnQueue* queue, size_t index, ChessGame* game,
+    ChessGame* scratch)
+{
+    ChessMappedReader reader;
+    ChessPgnLoader loader;
+    ChessPgnLoadResult result;
+    size_t begin, end;
+
+    begin = queue->starts[index];
+    end = (index + 1 < queue->num_games) ? queue->starts[index + 1] : queue->size;
+    chess_mapped_reader_init_data(&reader, queue->data + begin, end - begin);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+
+    result = chess_pgn_loader_next(&loader, game);
+    if (result == CHESS_PGN_LOAD_EOF
+        || chess_pgn_loader_next_tags(&loader, scratch) != CHESS_PGN_LOAD_EOF)
+        result = CHESS_PGN_LOAD_UNEXPECTED_TOKEN;
+
+    chess_pgn_loader_cleanup(&loader);
+    chess_mapped_reader_cleanup(&reader);
+    return result;
+}
+
+static size_t load_chunk(PgnQueue* queue, size_t chunk, ChessArray* loaded, ChessGame* scratch)
+{
+    PgnLoaded item;
+    size_t first = chunk * PGN_GAMES_PER_CHUNK;
+    size_t last = first + PGN_GAMES_PER_CHUNK;
+    size_t n, slot;
+
+    if (last > queue->num_games)
+        last = queue->num_games;
+
+    for (n = 0; first + n < last; n++)
+    {
+        /* In arrival order each game goes straight out, so one will do */
+        slot = queue->ordered ? n : 0;
+        if (slot == chess_array_size(loaded))
+        {
+            item.game = chess_game_new();
+            chess_array_push(loaded, &item);
+        }
+        memcpy(&item, chess_array_elem(loaded, slot), sizeof(PgnLoaded));
+
+        item.result = load_game(queue, first + n, item.game, scratch);
+        if (queue->ordered)
+        {
+            chess_array_set_elem(loaded, slot, &item);
+        }
+        else
+        {
+            pthread_mutex_lock(&queue->mutex);
+            deliver(queue, first + n, &item);
+            pthread_mutex_unlock(&queue->mutex);
+        }
+    }
+    return n;
+}
+
+static void* pgn_worker(void* data)
+{
+    PgnQueue* queue = (PgnQueue*)data;
+    ChessGame* scratch = chess_game_new();
+    ChessArray loaded;
+    size_t chunk, n, i;
+
+    chess_array_init(&loaded, sizeof(PgnLoaded));
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        chunk = queue->stopped ? queue->num_chunks : queue->next_chunk;
+        if (chunk < queue->num_chunks)
+            queue->next_chunk++;
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (chunk == queue->num_chunks)
+            break;
+
+        n = load_chunk(queue, chunk, &loaded, scratch);
+        if (!queue->ordered)
+            continue;
+
+        /* Chunks are handed out in order, so the one being waited for is
+         * always being loaded by some other thread */
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->next_delivery != chunk && !queue->stopped)
+            pthread_cond_wait(&queue->turn, &queue->mutex);
+        for (i = 0; i < n; i++)
+            deliver(queue, chunk * PGN_GAMES_PER_CHUNK + i, chess_array_elem(&loaded, i));
+        queue->next_delivery++;
+        pthread_cond_broadcast(&queue->turn);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    for (i = 0; i < chess_array_size(&loaded); i++)
+        chess_game_destroy(((const PgnLoaded*)chess_array_elem(&loaded, i))->game);
+    chess_array_cleanup(&loaded);
+    chess_game_destroy(scratch);
+    return NULL;
+}
+
+size_t chess_pgn_load_parallel(const char* data, size_t size, int threads,
+    ChessBoolean ordered, ChessPgnGameFunc func, void* func_data)
+{
+    ChessArray starts;
+    PgnQueue queue;
+    pthread_t* workers;
+    int num_workers, t;
+
+    chess_array_init(&starts, sizeof(size_t));
+    chess_pgn_find_games(data, size, &starts);
+    if (chess_array_size(&starts) == 0)
+    {
+        chess_array_cleanup(&starts);
+        return 0;
+    }
+
+    queue.data = data;
+    queue.size = size;
+    queue.starts = chess_array_data(&starts);
+    queue.num_games = chess_array_size(&starts);
+    queue.num_chunks = (queue.num_games + PGN_GAMES_PER_CHUNK - 1) / PGN_GAMES_PER_CHUNK;
+    queue.ordered = ordered;
+    queue.func = func;
+    queue.func_data = func_data;
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.turn, NULL);
+    queue.next_chunk = 0;
+    queue.next_delivery = 0;
+    queue.delivered = 0;
+    queue.stopped = CHESS_FALSE;
+
+    /* Whatever threads can't be started, the rest share the work */
+    if (threads < 1)
+        threads = 1;
+    workers = chess_alloc(threads * sizeof(pthread_t));
+    for (num_workers = 0; num_workers < threads - 1; num_workers++)
+    {
+        if (pthread_create(&workers[num_workers], NULL, pgn_worker, &queue) != 0)
+            break;
+    }
+    pgn_worker(&queue);
+    for (t = 0; t < num_workers; t++)
+        pthread_join(workers[t], NULL);
+
+    pthread_cond_destroy(&queue.turn);
+    pthread_mutex_destroy(&queue.mutex);
+    chess_free(workers);
+    chess_array_cleanup(&starts);
+    return queue.delivered;
+}
+
+static void* pgn_save_worker(void* data)
+{
+    PgnSaveQueue* queue = (PgnSaveQueue*)data;
+    ChessBufferWriter buffer;
+    size_t chunk, first, last, i;
+
+    chess_buffer_writer_init(&buffer);
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->mutex);
+        chunk = queue->next_chunk;
+        if (chunk < queue->num_chunks)
+            queue->next_chunk++;
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (chunk == queue->num_chunks)
+            break;
+
+        first = chunk * PGN_GAMES_PER_CHUNK;
+        last = first + PGN_GAMES_PER_CHUNK;
+        if (last > queue->num_games)
+            last = queue->num_games;
+
+        chess_buffer_writer_clear(&buffer);
+        for (i = first; i < last; i++)
+            chess_pgn_save(queue->games[i], (ChessWriter*)&buffer);
+
+        /* Only the thread whose turn it is writes, so the others can go on
+         * printing without waiting for the writer */
+        pthread_mutex_lock(&queue->mutex);
+        while (queue->next_delivery != chunk)
+            pthread_cond_wait(&queue->turn, &queue->mutex);
+        pthread_mutex_unlock(&queue->mutex);
+
+        chess_writer_write_string_size(queue->writer, chess_buffer_writer_data(&buffer),
+            chess_buffer_writer_size(&buffer));
+
+        pthread_mutex_lock(&queue->mutex);
+        queue->next_delivery++;
+        pthread_cond_broadcast(&queue->turn);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    chess_buffer_writer_cleanup(&buffer);
+    return NULL;
+}
+
+void chess_pgn_save_many(const ChessGame* const* games, size_t num_games, int threads,
+    ChessWriter* writer)
+{
+    PgnSaveQueue queue;
+    pthread_t* workers;
+    int num_workers, t;
+
+    if (num_games == 0)
+        return;
+
+    queue.games = games;
+    queue.num_games = num_games;
+    queue.num_chunks = (num_games + PGN_GAMES_PER_CHUNK - 1) / PGN_GAMES_PER_CHUNK;
+    queue.writer = writer;
+    pthread_mutex_init(&queue.mutex, NULL);
+    pthread_cond_init(&queue.turn, NULL);
+    queue.next_chunk = 0;
+    queue.next_delivery = 0;
+
+    if (threads < 1)
+        threads = 1;
+    workers = chess_alloc(threads * sizeof(pthread_t));
+    for (num_workers = 0; num_workers < threads - 1; num_workers++)
+    {
+        if (pthread_create(&workers[num_workers], NULL, pgn_save_worker, &queue) != 0)
+            break;
+    }
+    pgn_save_worker(&queue);
+    for (t = 0; t < num_workers; t++)
+        pthread_join(workers[t], NULL);
+
+    pthread_cond_destroy(&queue.turn);
+    pthread_mutex_destroy(&queue.mutex);
+    chess_free(workers);
+}
@@ -0,0 +1,43 @@
+#ifndef CHESSLIB_PGN_PARALLEL_H_
+#define CHESSLIB_PGN_PARALLEL_H_
+
+#include <stddef.h>
+
+#include "carray.h"
+#include "chess.h"
+#include "game.h"
+#include "pgn.h"
+#include "writer.h"
+
+/* Finds where each game in a PGN archive starts: at the first tag after
+ * movetext, outside comments. The offsets are pushed onto an array of
+ * size_t. */
+void chess_pgn_find_games(const char* data, size_t size, ChessArray* starts);
+
+/* Called with each game loaded (or not) and its index in the archive. The
+ * game is only valid during the call. Calls are never made at the same time,
+ * but may come from any thread. Return CHESS_FALSE to stop loading. */
+typedef ChessBoolean (*ChessPgnGameFunc)(void* data, size_t index,
+    ChessPgnLoadResult result, ChessGame* game);
+
+/* Loads all the games in an archive in memory (such as a ChessMappedReader's
+ * data) on the given number of threads. If ordered, games are passed to the
+ * callback in the order they appear, otherwise in the order they finish.
+ * Games are told apart with chess_pgn_find_games; if the loader finds no
+ * game or more than one where that found a game, it's passed on with
+ * CHESS_PGN_LOAD_UNEXPECTED_TOKEN, so the indices always match. Returns the
+ * number of games passed to the callback. */
+size_t chess_pgn_load_parallel(const char* data, size_t size, int threads,
+    ChessBoolean ordered, ChessPgnGameFunc func, void* func_data);
+
+/* Saves the games with chess_pgn_save on the given number of threads, each
+ * printing a run of games at a time into a buffer of its own. The buffers
+ * are passed to the writer in order, so the output is the same as saving
+ * the games one by one. The games are only read, through const accessors,
+ * so the same game may appear more than once, but nothing may change them
+ * until it returns. As with chess_pgn_save, deferred moves must have been
+ * loaded first. */
+void chess_pgn_save_many(const ChessGame* const* games, size_t num_games, int threads,
+    ChessWriter* writer);
+
+#endif /* CHESSLIB_PGN_PARALLEL_H_ */
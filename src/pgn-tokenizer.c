@@ -4,12 +4,122 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <assert.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "pgn-tokenizer.h"
+#include "bitboard.h"
 #include "chess.h"
 
 const int NOCHAR = -2;
 
+/* Scanning for the end of whitespace, comments and strings 16 bytes at a
+ * time where SSE2 is available. The tail, and everything elsewhere, is done
+ * one byte at a time. */
+static ChessBoolean is_space(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static const char* scan_space(const char* p, const char* end)
+{
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i below_tab = _mm_set1_epi8('\t' - 1);
+    const __m128i above_cr = _mm_set1_epi8('\r' + 1);
+    __m128i x;
+    unsigned int mask;
+
+    for (; end - p >= 16; p += 16)
+    {
+        x = _mm_loadu_si128((const __m128i*)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, space),
+            _mm_and_si128(_mm_cmpgt_epi8(x, below_tab), _mm_cmplt_epi8(x, above_cr))));
+        if (mask != 0xffff)
+            return p + CHESS_BITBOARD_LSB(~mask & 0xffff);
+    }
+#endif
+    while (p < end && is_space(*p))
+        p++;
+    return p;
+}
+
+static const char* scan_either(const char* p, const char* end, char a, char b)
+{
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    __m128i x;
+    unsigned int mask;
+
+    for (; end - p >= 16; p += 16)
+    {
+        x = _mm_loadu_si128((const __m128i*)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)));
+        if (mask)
+            return p + CHESS_BITBOARD_LSB(mask);
+    }
+#endif
+    while (p < end && *p != a && *p != b)
+        p++;
+    return p;
+}
+
+/* Returns the first bracket, brace or parenthesis in [p, end), or end */
+static const char* scan_brackets(const char* p, const char* end)
+{
+#if defined(__SSE2__)
+    const __m128i l_bracket = _mm_set1_epi8('['), l_brace = _mm_set1_epi8('{');
+    const __m128i r_brace = _mm_set1_epi8('}'), l_paren = _mm_set1_epi8('(');
+    const __m128i r_paren = _mm_set1_epi8(')');
+    __m128i x;
+    unsigned int mask;
+
+    for (; end - p >= 16; p += 16)
+    {
+        x = _mm_loadu_si128((const __m128i*)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, l_bracket), _mm_cmpeq_epi8(x, l_brace)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, r_brace),
+                _mm_or_si128(_mm_cmpeq_epi8(x, l_paren), _mm_cmpeq_epi8(x, r_paren)))));
+        if (mask)
+            return p + CHESS_BITBOARD_LSB(mask);
+    }
+#endif
+    while (p < end && !strchr("[{}()", *p))
+        p++;
+    return p;
+}
+
+/* Returns the number of newlines in [p, end), and the last one in *last */
+static size_t count_newlines(const char* p, const char* end, const char** last)
+{
+    size_t count = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    unsigned int mask;
+
+    for (; end - p >= 16; p += 16)
+    {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), newline));
+        if (mask)
+        {
+            count += CHESS_BITBOARD_COUNT(mask);
+            *last = p + CHESS_BITBOARD_MSB(mask);
+        }
+    }
+#endif
+    for (; p < end; p++)
+    {
+        if (*p == '\n')
+        {
+            count++;
+            *last = p;
+        }
+    }
+    return count;
+}
+
 static int tokenizer_getc(ChessPgnTokenizer* tokenizer)
 {
     if (tokenizer->nextc == NOCHAR)
@@ -28,25 +138,155 @@ static int tokenizer_getc(ChessPgnTokenizer* tokenizer)
     {
         tokenizer->nextc = NOCHAR;
     }
-    tokenizer->lastc = chess_reader_getc(tokenizer->reader);
+
+    if (tokenizer->span)
+    {
+        tokenizer->lastc = (tokenizer->cursor < tokenizer->span_end)
+            ? (unsigned char)*tokenizer->cursor++ : EOF;
+    }
+    else
+    {
+        tokenizer->lastc = chess_reader_getc(tokenizer->reader);
+    }
     return tokenizer->lastc;
 }
 
 static int tokenizer_peek(ChessPgnTokenizer* tokenizer)
 {
+    if (tokenizer->span)
+    {
+        return (tokenizer->cursor < tokenizer->span_end)
+            ? (unsigned char)*tokenizer->cursor : EOF;
+    }
     return chess_reader_peek(tokenizer->reader);
 }
 
 static void tokenizer_ungetc(ChessPgnTokenizer* tokenizer)
 {
-    chess_reader_ungetc(tokenizer->reader, tokenizer->lastc);
+    if (tokenizer->span)
+    {
+        if (tokenizer->lastc != EOF)
+            tokenizer->cursor--;
+    }
+    else
+    {
+        chess_reader_ungetc(tokenizer->reader, tokenizer->lastc);
+    }
     tokenizer->nextc = tokenizer->lastc;
     tokenizer->lastc = NOCHAR;
 }
 
+/* Consumes the span up to the given point as if by tokenizer_getc, but
+ * works out the line and column from the newlines in between */
+static void tokenizer_advance(ChessPgnTokenizer* tokenizer, const char* to)
+{
+    const char* from = tokenizer->cursor;
+    const char* last = NULL;
+    size_t newlines;
+
+    assert(tokenizer->span && tokenizer->nextc == NOCHAR);
+    if (to == from)
+        return;
+
+    /* Each character is placed by the one before it */
+    newlines = count_newlines(from, to - 1, &last);
+    if (newlines > 0)
+    {
+        tokenizer->line += newlines + (tokenizer->lastc == '\n');
+        tokenizer->col = to - 1 - last;
+    }
+    else if (tokenizer->lastc == '\n')
+    {
+        tokenizer->line++;
+        tokenizer->col = to - from;
+    }
+    else
+    {
+        tokenizer->col += to - from;
+    }
+
+    tokenizer->lastc = (unsigned char)to[-1];
+    tokenizer->cursor = to;
+}
+
+/* Readers over memory lend the tokenizer their bytes for the length of a
+ * token, which saves a call through the reader for every character. The
+ * reader catches up at the end of the token, so it can still be used
+ * directly between tokens. */
+static void begin_span(ChessPgnTokenizer* tokenizer)
+{
+    size_t size = chess_reader_span(tokenizer->reader, &tokenizer->span);
+    if (tokenizer->span)
+    {
+        tokenizer->span_end = tokenizer->span + size;
+        tokenizer->cursor = tokenizer->span;
+    }
+}
+
+static void end_span(ChessPgnTokenizer* tokenizer)
+{
+    if (tokenizer->span)
+    {
+        chess_reader_skip(tokenizer->reader, tokenizer->cursor - tokenizer->span);
+        tokenizer->span = NULL;
+    }
+}
+
+/* With views on, the text of a token is left where it is in the span and
+ * the token points at it. It is only copied into the buffer when there is no
+ * span, or when it has to be changed (an escaped quote in a string). */
+static void text_begin(ChessPgnTokenizer* tokenizer, size_t already_read)
+{
+    chess_buffer_clear(&tokenizer->buffer);
+    tokenizer->copying = !(tokenizer->views && tokenizer->span);
+    if (!tokenizer->copying)
+        tokenizer->text = tokenizer->cursor - already_read;
+}
+
+static void text_append(ChessPgnTokenizer* tokenizer, int c)
+{
+    if (tokenizer->copying)
+        chess_buffer_append_char(&tokenizer->buffer, c);
+}
+
+/* Switches to copying, keeping the text up to but not including the last
+ * character read */
+static void text_materialise(ChessPgnTokenizer* tokenizer)
+{
+    if (!tokenizer->copying)
+    {
+        chess_buffer_append_string_size(&tokenizer->buffer, tokenizer->text,
+            tokenizer->cursor - 1 - tokenizer->text);
+        tokenizer->copying = CHESS_TRUE;
+    }
+}
+
+/* Ends the text before the last trailing characters read */
+static void text_end(ChessPgnTokenizer* tokenizer, size_t trailing)
+{
+    if (tokenizer->copying)
+    {
+        tokenizer->text = chess_buffer_data(&tokenizer->buffer);
+        tokenizer->text_size = chess_buffer_size(&tokenizer->buffer);
+    }
+    else
+    {
+        tokenizer->text_size = tokenizer->cursor - trailing - tokenizer->text;
+    }
+}
+
+static ChessBoolean text_equals(const ChessPgnTokenizer* tokenizer, const char* s)
+{
+    size_t n = strlen(s);
+    return tokenizer->text_size == n && !memcmp(tokenizer->text, s, n);
+}
+
 static void token_init(ChessPgnToken* token)
 {
     token->type = CHESS_PGN_TOKEN_NONE;
+    token->data = NULL;
+    token->size = 0;
+    token->source = NULL;
     chess_string_init(&token->string);
 }
 
@@ -58,120 +298,166 @@ static void token_cleanup(ChessPgnToken* token)
 static void token_assign_simple(ChessPgnToken* token, ChessPgnTokenType type)
 {
     token->type = type;
+    token->data = NULL;
+    token->size = 0;
 }
 
-static void token_assign_symbol(ChessPgnToken* token, ChessBuffer* buffer)
-{
-    token->type = CHESS_PGN_TOKEN_SYMBOL;
-    chess_string_assign_size(&token->string,
-        chess_buffer_data(buffer), chess_buffer_size(buffer));
-}
-
-static void token_assign_string(ChessPgnToken* token, ChessBuffer* buffer)
-{
-    token->type = CHESS_PGN_TOKEN_STRING;
-    chess_string_assign_size(&token->string,
-        chess_buffer_data(buffer), chess_buffer_size(buffer));
-}
-
-static void token_assign_comment(ChessPgnToken* token, ChessBuffer* buffer)
+static void token_assign_text(ChessPgnToken* token, ChessPgnTokenType type,
+    ChessPgnTokenizer* tokenizer)
 {
-    token->type = CHESS_PGN_TOKEN_COMMENT;
-    chess_string_assign_size(&token->string,
-        chess_buffer_data(buffer), chess_buffer_size(buffer));
+    token->type = type;
+    if (tokenizer->copying)
+    {
+        chess_string_assign_size(&token->string, tokenizer->text, tokenizer->text_size);
+        token->data = token->string.data;
+        token->size = token->string.size;
+    }
+    else
+    {
+        chess_string_clear(&token->string);
+        token->data = tokenizer->text;
+        token->size = tokenizer->text_size;
+    }
 }
 
 static void token_assign_error(ChessPgnToken* token, const char* s)
 {
     token->type = CHESS_PGN_TOKEN_ERROR;
     chess_string_assign(&token->string, s);
+    token->data = token->string.data;
+    token->size = token->string.size;
+}
+
+static int text_to_number(const ChessPgnTokenizer* tokenizer)
+{
+    size_t i;
+    int n = 0;
+    for (i = 0; i < tokenizer->text_size; i++)
+        n = n * 10 + (tokenizer->text[i] - '0');
+    return n;
 }
 
-static ChessBoolean token_assign_number(ChessPgnToken* token, ChessBuffer* buffer)
+static ChessBoolean token_assign_number(ChessPgnToken* token, ChessPgnTokenizer* tokenizer)
 {
-    size_t i, n = chess_buffer_size(buffer);
-    char* s = chess_buffer_data(buffer);
+    size_t i;
 
-    if (n == 0)
+    if (tokenizer->text_size == 0)
         return CHESS_FALSE;
 
-    for (i = 0; i < n; i++)
-        if (!isdigit(s[i]))
+    for (i = 0; i < tokenizer->text_size; i++)
+        if (!isdigit((unsigned char)tokenizer->text[i]))
             return CHESS_FALSE;
 
-    token->type = CHESS_PGN_TOKEN_NUMBER;
-    token->number = strtol(s, NULL, 10);
+    token_assign_simple(token, CHESS_PGN_TOKEN_NUMBER);
+    token->number = text_to_number(tokenizer);
     return CHESS_TRUE;
 }
 
-static void token_assign_nag(ChessPgnToken* token, ChessBuffer* buffer)
+static void token_assign_nag(ChessPgnToken* token, ChessPgnTokenizer* tokenizer)
 {
-    chess_buffer_null_terminate(buffer);
-    token->type = CHESS_PGN_TOKEN_NAG;
-    token->number = strtol(chess_buffer_data(buffer), NULL, 10);
+    token_assign_simple(token, CHESS_PGN_TOKEN_NAG);
+    token->number = text_to_number(tokenizer);
+}
+
+/* Consumes everything up to the next a or b in one go, when there's a span */
+static void read_run(ChessPgnTokenizer* tokenizer, char a, char b)
+{
+    const char* to;
+
+    if (!tokenizer->span || tokenizer->nextc != NOCHAR)
+        return;
+
+    to = scan_either(tokenizer->cursor, tokenizer->span_end, a, b);
+    if (tokenizer->copying)
+    {
+        chess_buffer_append_string_size(&tokenizer->buffer, tokenizer->cursor,
+            to - tokenizer->cursor);
+    }
+    tokenizer_advance(tokenizer, to);
 }
 
 static ChessBoolean read_string_token(ChessPgnTokenizer* tokenizer)
 {
     /* Eat everything, but check for escape chars */
     int c;
-    while ((c = tokenizer_getc(tokenizer)) != EOF)
+    text_begin(tokenizer, 0);
+    for (read_run(tokenizer, '"', '\\');
+         (c = tokenizer_getc(tokenizer)) != EOF;
+         read_run(tokenizer, '"', '\\'))
     {
         if (c == '"')
+        {
+            text_end(tokenizer, 1);
             return CHESS_TRUE;
+        }
 
         if (c == '\\' && tokenizer_peek(tokenizer) == '"')
+        {
+            text_materialise(tokenizer);
             c = tokenizer_getc(tokenizer);
+        }
 
-        chess_buffer_append_char(&tokenizer->buffer, c);
+        text_append(tokenizer, c);
     }
     return CHESS_FALSE; /* Not terminated */
 }
 
-static void read_symbol_token(ChessPgnTokenizer* tokenizer)
+static void read_symbol_token(ChessPgnTokenizer* tokenizer, int first)
 {
     int c;
+    text_begin(tokenizer, 1);
+    text_append(tokenizer, first);
     while ((c = tokenizer_getc(tokenizer)) != EOF
         && (isalnum(c) || strchr("_+#=:-/", c)))
-            chess_buffer_append_char(&tokenizer->buffer, c);
+            text_append(tokenizer, c);
     tokenizer_ungetc(tokenizer);
+    text_end(tokenizer, 0);
 }
 
 static void read_number_token(ChessPgnTokenizer* tokenizer)
 {
     int c;
+    text_begin(tokenizer, 0);
     while ((c = tokenizer_getc(tokenizer)) != EOF && isnumber(c))
-        chess_buffer_append_char(&tokenizer->buffer, c);
+        text_append(tokenizer, c);
     tokenizer_ungetc(tokenizer);
+    text_end(tokenizer, 0);
 }
 
 static ChessBoolean read_comment_token(ChessPgnTokenizer* tokenizer)
 {
     int c;
-    while ((c = tokenizer_getc(tokenizer)) != EOF)
+    text_begin(tokenizer, 0);
+    for (read_run(tokenizer, '}', '}');
+         (c = tokenizer_getc(tokenizer)) != EOF;
+         read_run(tokenizer, '}', '}'))
     {
         if (c == '}')
+        {
+            text_end(tokenizer, 1);
             return CHESS_TRUE;
+        }
 
-        chess_buffer_append_char(&tokenizer->buffer, c);
+        text_append(tokenizer, c);
     }
     return CHESS_FALSE; /* Not terminated */
 }
 
-static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
+static ChessPgnToken* read_token_chars(ChessPgnTokenizer* tokenizer)
 {
     ChessPgnToken* token = &tokenizer->tokens[tokenizer->count++ % 2];
-    ChessBuffer* buffer = &tokenizer->buffer;
     ChessBoolean ok;
     int c;
 
     while (isspace(c = tokenizer_getc(tokenizer)))
-        ;
+    {
+        if (tokenizer->span)
+            tokenizer_advance(tokenizer, scan_space(tokenizer->cursor, tokenizer->span_end));
+    }
 
     token->line = tokenizer->line;
     token->col = tokenizer->col;
-
-    chess_buffer_clear(buffer);
+    token->source = tokenizer->span ? tokenizer->cursor - (c != EOF) : NULL;
 
     if (c == '"')
     {
@@ -182,7 +468,7 @@ static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
             token_assign_error(token, "Unterminated string token.");
             return token;
         }
-        token_assign_string(token, buffer);
+        token_assign_text(token, CHESS_PGN_TOKEN_STRING, tokenizer);
         return token;
     }
 
@@ -190,12 +476,12 @@ static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
     {
         /* NAG token */
         read_number_token(tokenizer);
-        if (chess_buffer_size(buffer) == 0)
+        if (tokenizer->text_size == 0)
         {
             token_assign_error(token, "Invalid NAG token.");
             return token;
         }
-        token_assign_nag(token, buffer);
+        token_assign_nag(token, tokenizer);
         return token;
     }
 
@@ -208,34 +494,32 @@ static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
             token_assign_error(token, "Unterminated comment token.");
             return token;
         }
-        token_assign_comment(token, buffer);
+        token_assign_text(token, CHESS_PGN_TOKEN_COMMENT, tokenizer);
         return token;
     }
 
     if (isalnum(c) || c == '-')
     {
         /* Symbol or integer token */
-        chess_buffer_append_char(buffer, c);
-        read_symbol_token(tokenizer);
-        chess_buffer_null_terminate(buffer);
+        read_symbol_token(tokenizer, c);
 
-        if (!token_assign_number(token, buffer))
+        if (!token_assign_number(token, tokenizer))
         {
-            if (!strcmp(chess_buffer_data(buffer), "1-0"))
+            if (text_equals(tokenizer, "1-0"))
             {
                 token_assign_simple(token, CHESS_PGN_TOKEN_ONE_ZERO);
             }
-            else if (!strcmp(chess_buffer_data(buffer), "0-1"))
+            else if (text_equals(tokenizer, "0-1"))
             {
                 token_assign_simple(token, CHESS_PGN_TOKEN_ZERO_ONE);
             }
-            else if (!strcmp(chess_buffer_data(buffer), "1/2-1/2"))
+            else if (text_equals(tokenizer, "1/2-1/2"))
             {
                 token_assign_simple(token, CHESS_PGN_TOKEN_HALF_HALF);
             }
             else
             {
-                token_assign_symbol(token, buffer);
+                token_assign_text(token, CHESS_PGN_TOKEN_SYMBOL, tokenizer);
             }
 
         }
@@ -272,6 +556,15 @@ static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
     }
 }
 
+static ChessPgnToken* read_token(ChessPgnTokenizer* tokenizer)
+{
+    ChessPgnToken* token;
+    begin_span(tokenizer);
+    token = read_token_chars(tokenizer);
+    end_span(tokenizer);
+    return token;
+}
+
 void chess_pgn_tokenizer_init(ChessPgnTokenizer* tokenizer, ChessReader* reader)
 {
     memset(tokenizer, 0, sizeof(ChessPgnTokenizer));
@@ -285,6 +578,11 @@ void chess_pgn_tokenizer_init(ChessPgnTokenizer* tokenizer, ChessReader* reader)
     chess_buffer_init(&tokenizer->buffer);
 }
 
+void chess_pgn_tokenizer_set_views(ChessPgnTokenizer* tokenizer, ChessBoolean views)
+{
+    tokenizer->views = views;
+}
+
 void chess_pgn_tokenizer_cleanup(ChessPgnTokenizer* tokenizer)
 {
     token_cleanup(&tokenizer->tokens[0]);
@@ -305,6 +603,50 @@ void chess_pgn_tokenizer_consume(ChessPgnTokenizer* tokenizer)
     tokenizer->next = NULL;
 }
 
+const char* chess_pgn_tokenizer_skip_movetext(ChessPgnTokenizer* tokenizer, int depth)
+{
+    ChessBoolean comment = CHESS_FALSE;
+    const char* stop;
+    int c;
+
+    assert(tokenizer->next == NULL);
+    begin_span(tokenizer);
+    for (;;)
+    {
+        if (tokenizer->span && tokenizer->nextc == NOCHAR)
+            tokenizer_advance(tokenizer, scan_brackets(tokenizer->cursor, tokenizer->span_end));
+
+        c = tokenizer_getc(tokenizer);
+        if (c == EOF)
+            break;
+
+        if (comment)
+        {
+            comment = (c != '}');
+        }
+        else if (c == '{')
+        {
+            comment = CHESS_TRUE;
+        }
+        else if (c == '(')
+        {
+            depth++;
+        }
+        else if (c == ')' && depth > 0)
+        {
+            depth--;
+        }
+        else if (c == '[' && depth == 0)
+        {
+            tokenizer_ungetc(tokenizer);
+            break;
+        }
+    }
+    stop = tokenizer->span ? tokenizer->cursor : NULL;
+    end_span(tokenizer);
+    return stop;
+}
+
 const ChessPgnToken* chess_pgn_tokenizer_next(ChessPgnTokenizer* tokenizer)
 {
     const ChessPgnToken* last;
@@ -30,27 +30,45 @@ typedef struct
 {
     unsigned int line, col;
     ChessPgnTokenType type;
+    const char* data; /* text of symbols, strings, comments and errors */
+    size_t size;      /* not null terminated when it's a view */
     ChessString string;
     int number;
+    const char* source; /* where it starts, if the reader lends its memory */
 } ChessPgnToken;
 
 typedef struct
 {
     ChessReader* reader;
+    const char* span, *span_end, *cursor; /* borrowed from the reader */
     int lastc, nextc;
     unsigned int line, col;
     ChessPgnToken* next;
     ChessPgnToken tokens[2];
     int count;
     ChessBuffer buffer;
+    ChessBoolean views, copying;
+    const char* text;
+    size_t text_size;
 } ChessPgnTokenizer;
 
 void chess_pgn_tokenizer_init(ChessPgnTokenizer*, ChessReader*);
 void chess_pgn_tokenizer_cleanup(ChessPgnTokenizer*);
 
+/* In view mode, tokens read from a reader that lends spans point straight
+ * into the reader's memory and stay valid as long as the reader does. Only
+ * data and size are set; strings with escapes are still copied. Off by
+ * default, when string is set too. */
+void chess_pgn_tokenizer_set_views(ChessPgnTokenizer*, ChessBoolean views);
+
 const ChessPgnToken* chess_pgn_tokenizer_peek(ChessPgnTokenizer*);
 void chess_pgn_tokenizer_consume(ChessPgnTokenizer*);
 
 const ChessPgnToken* chess_pgn_tokenizer_next(ChessPgnTokenizer*);
 
+/* Skips characters up to the next '[' that isn't inside a comment or one
+ * of depth open variations, without making tokens. Nothing may be peeked.
+ * Returns where it stopped, if the reader lends its memory, or NULL. */
+const char* chess_pgn_tokenizer_skip_movetext(ChessPgnTokenizer*, int depth);
+
 #endif /* CHESSLIB_PGN_TOKENIZER_H_ */
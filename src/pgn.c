@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -9,11 +10,31 @@
 
 static void append_tag(const char* name, const char* value, ChessWriter* writer)
 {
-    chess_writer_write_char(writer, '[');
-    chess_writer_write_string(writer, name);
-    chess_writer_write_string(writer, " \"");
-    chess_writer_write_string(writer, value);
-    chess_writer_write_string(writer, "\"]\n");
+    char buf[256];
+    size_t name_size = strlen(name), value_size = strlen(value), n = 0;
+
+    if (name_size + value_size + 6 > sizeof(buf))
+    {
+        chess_writer_write_char(writer, '[');
+        chess_writer_write_string_size(writer, name, name_size);
+        chess_writer_write_string_size(writer, " \"", 2);
+        chess_writer_write_string_size(writer, value, value_size);
+        chess_writer_write_string_size(writer, "\"]\n", 3);
+        return;
+    }
+
+    /* Most tags fit in one write */
+    buf[n++] = '[';
+    memcpy(buf + n, name, name_size);
+    n += name_size;
+    buf[n++] = ' ';
+    buf[n++] = '"';
+    memcpy(buf + n, value, value_size);
+    n += value_size;
+    buf[n++] = '"';
+    buf[n++] = ']';
+    buf[n++] = '\n';
+    chess_writer_write_string_size(writer, buf, n);
 }
 
 void chess_pgn_save(const ChessGame* game, ChessWriter* writer)
@@ -47,7 +68,7 @@ static ChessPgnLoadResult parse_tag(ChessPgnTokenizer* tokenizer, ChessGame* gam
         result = CHESS_PGN_LOAD_UNEXPECTED_TOKEN;
         goto error;
     }
-    chess_string_assign(&tag, token->string.data);
+    chess_string_assign_size(&tag, token->data, token->size);
 
     token = chess_pgn_tokenizer_next(tokenizer);
     if (token->type != CHESS_PGN_TOKEN_STRING)
@@ -55,7 +76,7 @@ static ChessPgnLoadResult parse_tag(ChessPgnTokenizer* tokenizer, ChessGame* gam
         result = CHESS_PGN_LOAD_UNEXPECTED_TOKEN;
         goto error;
     }
-    chess_string_assign(&value, token->string.data);
+    chess_string_assign_size(&value, token->data, token->size);
 
     token = chess_pgn_tokenizer_next(tokenizer);
     if (token->type != CHESS_PGN_TOKEN_R_BRACKET)
@@ -77,9 +98,16 @@ static ChessPgnLoadResult parse_move(ChessPgnTokenizer* tokenizer,
 {
     ChessParseMoveResult result;
     const ChessPgnToken* token;
+    char san[16];
 
     token = chess_pgn_tokenizer_peek(tokenizer); /* SYMBOL */
-    result = chess_parse_move(token->string.data, position, move);
+    if (token->size >= sizeof(san))
+        return CHESS_PGN_LOAD_ILLEGAL_MOVE;
+
+    /* The token may be a view, so terminate a copy of it */
+    memcpy(san, token->data, token->size);
+    san[token->size] = '\0';
+    result = chess_parse_move(san, position, move);
     if (result != CHESS_PARSE_MOVE_OK)
         return CHESS_PGN_LOAD_ILLEGAL_MOVE;
 
@@ -87,8 +115,18 @@ static ChessPgnLoadResult parse_move(ChessPgnTokenizer* tokenizer,
     return CHESS_PGN_LOAD_OK;
 }
 
+/* The last move of a compact mainline, once it's made into a tree */
+static ChessVariation* last_mainline_node(ChessGame* game)
+{
+    ChessVariation* root = chess_game_root_variation(game);
+    size_t ply = chess_game_ply(game);
+    return (ply > 0) ? chess_variation_ply(root, ply - 1) : root;
+}
+
+/* Moves go into the variation under root, or if that's NULL, onto the end
+ * of the game's compact mainline until something needs the tree */
 static ChessPgnLoadResult parse_variation(ChessPgnTokenizer* tokenizer,
-    const ChessPosition* initial_position, ChessVariation* root)
+    const ChessPosition* initial_position, ChessVariation* root, ChessGame* game)
 {
     const ChessPgnToken* token;
     ChessMove move;
@@ -96,6 +134,7 @@ static ChessPgnLoadResult parse_variation(ChessPgnTokenizer* tokenizer,
     ChessPgnLoadResult result;
     ChessPosition position;
     ChessVariation* variation = root;
+    ChessBoolean moved = CHESS_FALSE;
  
     chess_position_copy(initial_position, &position);
     for (;;)
@@ -119,24 +158,32 @@ static ChessPgnLoadResult parse_variation(ChessPgnTokenizer* tokenizer,
                     return result;
 
                 unmove = chess_position_make_move(&position, move);
-                variation = chess_variation_add_child(variation, move);
+                if (variation)
+                    variation = chess_variation_add_child(variation, move);
+                else
+                    chess_game_append_move(game, move);
+                moved = CHESS_TRUE;
                 break;
             case CHESS_PGN_TOKEN_NAG:
-                if (variation == root)
+                if (!moved)
                     return CHESS_PGN_LOAD_UNEXPECTED_TOKEN;
 
+                if (variation == NULL)
+                    variation = last_mainline_node(game);
                 chess_variation_add_annotation(variation, token->number);
                 chess_pgn_tokenizer_consume(tokenizer);
                 break;
             case CHESS_PGN_TOKEN_L_PARENTHESIS:
-                if (variation == root)
+                if (!moved)
                     return CHESS_PGN_LOAD_UNEXPECTED_TOKEN;
 
                 chess_pgn_tokenizer_consume(tokenizer);
+                if (variation == NULL)
+                    variation = last_mainline_node(game);
 
                 /* Subvariation, back up a move and parse it */
                 chess_position_undo_move(&position, unmove);
-                result = parse_variation(tokenizer, &position, variation->parent);
+                result = parse_variation(tokenizer, &position, variation->parent, NULL);
                 if (result != CHESS_PGN_LOAD_OK)
                     return result;
 
@@ -161,7 +208,8 @@ static ChessPgnLoadResult parse_movetext(ChessPgnTokenizer* tokenizer, ChessGame
     const ChessPgnToken* token;
     ChessResult game_result;
 
-    result = parse_variation(tokenizer, chess_game_initial_position(game), chess_game_root_variation(game));
+    result = parse_variation(tokenizer, chess_game_initial_position(game),
+        chess_game_is_compact(game) ? NULL : chess_game_root_variation(game), game);
     if (result != CHESS_PGN_LOAD_OK)
         return result;
 
@@ -209,7 +257,7 @@ static void check_setup_tag(ChessGame* game)
     chess_game_set_initial_position(game, &position);
 }
 
-static ChessPgnLoadResult parse_game(ChessPgnTokenizer* tokenizer, ChessGame* game)
+static ChessPgnLoadResult parse_tags(ChessPgnTokenizer* tokenizer, ChessGame* game)
 {
     const ChessPgnToken* token;
     ChessPgnLoadResult result;
@@ -230,16 +278,69 @@ static ChessPgnLoadResult parse_game(ChessPgnTokenizer* tokenizer, ChessGame* ga
                 break;
             default:
                 check_setup_tag(game);
-                return parse_movetext(tokenizer, game);
+                return CHESS_PGN_LOAD_OK;
         }
     }
 }
 
+static ChessPgnLoadResult parse_game(ChessPgnTokenizer* tokenizer, ChessGame* game)
+{
+    ChessPgnLoadResult result = parse_tags(tokenizer, game);
+    if (result != CHESS_PGN_LOAD_OK)
+        return result;
+
+    return parse_movetext(tokenizer, game);
+}
+
+static ChessBoolean load_deferred_moves(ChessGame* game, const char* text, size_t size)
+{
+    ChessMappedReader reader;
+    ChessPgnTokenizer tokenizer;
+    ChessPgnLoadResult result;
+
+    chess_mapped_reader_init_data(&reader, text, size);
+    chess_pgn_tokenizer_init(&tokenizer, (ChessReader*)&reader);
+    chess_pgn_tokenizer_set_views(&tokenizer, CHESS_TRUE);
+    result = parse_movetext(&tokenizer, game);
+    chess_pgn_tokenizer_cleanup(&tokenizer);
+    chess_mapped_reader_cleanup(&reader);
+    return result == CHESS_PGN_LOAD_OK;
+}
+
+/* Leaves the movetext in the reader's memory, to be parsed when the game's
+ * moves are first used. Readers that don't lend memory are parsed now. */
+static ChessPgnLoadResult defer_movetext(ChessPgnTokenizer* tokenizer, ChessGame* game)
+{
+    const ChessPgnToken* token = chess_pgn_tokenizer_peek(tokenizer);
+    const char* start = token->source, *end;
+    int depth;
+
+    if (start == NULL)
+        return parse_movetext(tokenizer, game);
+
+    depth = (token->type == CHESS_PGN_TOKEN_L_PARENTHESIS);
+    chess_pgn_tokenizer_consume(tokenizer);
+    end = chess_pgn_tokenizer_skip_movetext(tokenizer, depth);
+    assert(end != NULL);
+
+    chess_game_defer_moves(game, load_deferred_moves, start, end - start);
+    return CHESS_PGN_LOAD_OK;
+}
+
+static void skip_movetext(ChessPgnTokenizer* tokenizer)
+{
+    /* The first token has been read already */
+    int depth = (chess_pgn_tokenizer_peek(tokenizer)->type == CHESS_PGN_TOKEN_L_PARENTHESIS);
+    chess_pgn_tokenizer_consume(tokenizer);
+    chess_pgn_tokenizer_skip_movetext(tokenizer, depth);
+}
+
 ChessPgnLoadResult chess_pgn_load(ChessReader* reader, ChessGame* game)
 {
     ChessPgnTokenizer tokenizer;
     ChessPgnLoadResult result;
     chess_pgn_tokenizer_init(&tokenizer, reader);
+    chess_pgn_tokenizer_set_views(&tokenizer, CHESS_TRUE);
     result = parse_game(&tokenizer, game);
     chess_pgn_tokenizer_cleanup(&tokenizer);
     return result;
@@ -248,7 +349,9 @@ ChessPgnLoadResult chess_pgn_load(ChessReader* reader, ChessGame* game)
 void chess_pgn_loader_init(ChessPgnLoader* loader, ChessReader* reader)
 {
     loader->reader = reader;
+    loader->defer_moves = CHESS_FALSE;
     chess_pgn_tokenizer_init(&loader->tokenizer, reader);
+    chess_pgn_tokenizer_set_views(&loader->tokenizer, CHESS_TRUE);
 }
 
 void chess_pgn_loader_cleanup(ChessPgnLoader* loader)
@@ -256,7 +359,8 @@ void chess_pgn_loader_cleanup(ChessPgnLoader* loader)
     chess_pgn_tokenizer_cleanup(&loader->tokenizer);
 }
 
-ChessPgnLoadResult chess_pgn_loader_next(ChessPgnLoader* loader, ChessGame* game)
+/* Skips anything up to the start of the next game */
+static ChessPgnLoadResult find_game(ChessPgnLoader* loader)
 {
     const ChessPgnToken* token;
 
@@ -272,8 +376,42 @@ ChessPgnLoadResult chess_pgn_loader_next(ChessPgnLoader* loader, ChessGame* game
 
         chess_pgn_tokenizer_consume(&loader->tokenizer);
     }
+    return CHESS_PGN_LOAD_OK;
+}
+
+void chess_pgn_loader_set_defer_moves(ChessPgnLoader* loader, ChessBoolean defer_moves)
+{
+    loader->defer_moves = defer_moves;
+}
 
-    return parse_game(&loader->tokenizer, game);
+ChessPgnLoadResult chess_pgn_loader_next(ChessPgnLoader* loader, ChessGame* game)
+{
+    ChessPgnLoadResult result = find_game(loader);
+    if (result != CHESS_PGN_LOAD_OK)
+        return result;
+
+    if (!loader->defer_moves)
+        return parse_game(&loader->tokenizer, game);
+
+    result = parse_tags(&loader->tokenizer, game);
+    if (result != CHESS_PGN_LOAD_OK)
+        return result;
+
+    return defer_movetext(&loader->tokenizer, game);
+}
+
+ChessPgnLoadResult chess_pgn_loader_next_tags(ChessPgnLoader* loader, ChessGame* game)
+{
+    ChessPgnLoadResult result = find_game(loader);
+    if (result != CHESS_PGN_LOAD_OK)
+        return result;
+
+    result = parse_tags(&loader->tokenizer, game);
+    if (result != CHESS_PGN_LOAD_OK)
+        return result;
+
+    skip_movetext(&loader->tokenizer);
+    return CHESS_PGN_LOAD_OK;
 }
 
 const ChessPgnToken* chess_pgn_loader_last_token(ChessPgnLoader* loader)
@@ -21,12 +21,23 @@ typedef struct
 {
     ChessReader* reader;
     ChessPgnTokenizer tokenizer;
+    ChessBoolean defer_moves;
 } ChessPgnLoader;
 
 void chess_pgn_loader_init(ChessPgnLoader*, ChessReader*);
 void chess_pgn_loader_cleanup(ChessPgnLoader*);
 
+/* When on, and the reader lends its memory (buffer and mapped readers), the
+ * loader only reads the tags and leaves the moves to be parsed when loaded
+ * (see chess_game_defer_moves). The reader's memory must then outlive the
+ * games, and errors in the moves show up in chess_game_load_moves, which
+ * must be called before saving them or using other const accessors. */
+void chess_pgn_loader_set_defer_moves(ChessPgnLoader*, ChessBoolean);
+
 ChessPgnLoadResult chess_pgn_loader_next(ChessPgnLoader*, ChessGame*);
+/* Loads only the tags of the next game, skipping its movetext without
+ * reading the moves. The result comes from the Result tag. */
+ChessPgnLoadResult chess_pgn_loader_next_tags(ChessPgnLoader*, ChessGame*);
 const ChessPgnToken* chess_pgn_loader_last_token(ChessPgnLoader*);
 
 #endif /* CHESSLIB_PGN_H_ */
@@ -0,0 +1,136 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fen.h"
+#include "position-index.h"
+
+/* The entries are sorted by hash, game and ply */
+static const char INDEX_MAGIC[8] = { 'C', 'H', 'S', 'I', 1, 0, 0, 0 };
+
+static int compare_entries(const void* a, const void* b)
+{
+    const ChessPositionIndexEntry* x = a, *y = b;
+
+    if (x->hash != y->hash)
+        return (x->hash < y->hash) ? -1 : 1;
+    if (x->game != y->game)
+        return (x->game < y->game) ? -1 : 1;
+    if (x->ply != y->ply)
+        return (x->ply < y->ply) ? -1 : 1;
+    return 0;
+}
+
+void chess_position_index_builder_init(ChessPositionIndexBuilder* builder, size_t max_memory)
+{
+    chess_array_init(&builder->entries, sizeof(ChessPositionIndexEntry));
+    builder->max_entries = max_memory / sizeof(ChessPositionIndexEntry);
+    chess_hash_file_runs_init(&builder->runs, sizeof(ChessPositionIndexEntry),
+        compare_entries, NULL);
+}
+
+void chess_position_index_builder_cleanup(ChessPositionIndexBuilder* builder)
+{
+    chess_hash_file_runs_cleanup(&builder->runs);
+    chess_array_cleanup(&builder->entries);
+}
+
+/* Sorted in place, as only the order changes */
+static void sort_entries(ChessPositionIndexBuilder* builder)
+{
+    size_t size = chess_array_size(&builder->entries);
+
+    if (size > 0)
+        qsort(builder->entries.data, size,
+            sizeof(ChessPositionIndexEntry), compare_entries);
+}
+
+static ChessBoolean spill_entries(ChessPositionIndexBuilder* builder)
+{
+    sort_entries(builder);
+    if (!chess_hash_file_runs_add(&builder->runs, chess_array_data(&builder->entries),
+        chess_array_size(&builder->entries)))
+        return CHESS_FALSE;
+
+    chess_array_clear(&builder->entries);
+    return CHESS_TRUE;
+}
+
+ChessBoolean chess_position_index_builder_add_game(ChessPositionIndexBuilder* builder,
+    ChessGame* game, uint32_t game_id)
+{
+    ChessPosition position;
+    ChessPositionIndexEntry entry;
+    size_t ply, i;
+
+    if (!chess_game_load_moves(game))
+        return CHESS_FALSE;
+
+    /* The mainline is all that's needed, so replay it straight from the
+     * moves rather than through an iterator and the variation tree */
+    ply = chess_game_ply(game);
+    chess_position_copy(chess_game_initial_position(game), &position);
+    entry.game = game_id;
+    for (i = 0; ; i++)
+    {
+        entry.hash = chess_position_hash(&position);
+        entry.ply = (uint32_t)i;
+        chess_array_push(&builder->entries, &entry);
+        if (i == ply)
+            break;
+        chess_position_make_move(&position, chess_game_move_at_ply(game, i));
+    }
+
+    /* Past the limit they go to disk, unless that fails, when there's no
+     * choice but to keep them */
+    if (chess_array_size(&builder->entries) > builder->max_entries)
+        spill_entries(builder);
+    return CHESS_TRUE;
+}
+
+ChessBoolean chess_position_index_builder_save(ChessPositionIndexBuilder* builder, const char* filename)
+{
+    size_t size = chess_array_size(&builder->entries);
+
+    sort_entries(builder);
+    return chess_hash_file_runs_save(&builder->runs, filename, INDEX_MAGIC,
+        size > 0 ? chess_array_data(&builder->entries) : NULL, size);
+}
+
+ChessBoolean chess_position_index_init(ChessPositionIndex* index, const char* filename)
+{
+    ChessBoolean ok = chess_hash_file_open(&index->file, filename,
+        INDEX_MAGIC, sizeof(ChessPositionIndexEntry));
+
+    index->entries = (const ChessPositionIndexEntry*)index->file.records;
+    index->num_entries = index->file.num_records;
+    return ok;
+}
+
+void chess_position_index_cleanup(ChessPositionIndex* index)
+{
+    chess_hash_file_close(&index->file);
+}
+
+size_t chess_position_index_find(const ChessPositionIndex* index, ChessHash hash,
+    const ChessPositionIndexEntry** entries)
+{
+    const void* records;
+    size_t count = chess_hash_file_find(&index->file, hash, &records);
+
+    *entries = records;
+    return count;
+}
+
+size_t chess_position_index_find_fen(const ChessPositionIndex* index, const char* fen,
+    const ChessPositionIndexEntry** entries)
+{
+    ChessPosition position;
+
+    *entries = index->entries;
+    if (!chess_fen_load(fen, &position))
+        return 0;
+
+    return chess_position_index_find(index, chess_position_hash(&position), entries);
+}
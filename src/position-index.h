@@ -0,0 +1,64 @@
+#ifndef CHESSLIB_POSITION_INDEX_H_
+#define CHESSLIB_POSITION_INDEX_H_
+
+#include <stdint.h>
+
+#include "carray.h"
+#include "game.h"
+#include "hash-file.h"
+#include "zobrist.h"
+
+/* An index from positions to the games (and plies) that reach them along
+ * their mainlines, kept in a file that is searched in place. Positions are
+ * matched by hash, so there may (very rarely) be false matches. */
+
+typedef struct
+{
+    ChessHash hash;
+    uint32_t game;
+    uint32_t ply;
+} ChessPositionIndexEntry;
+
+typedef struct
+{
+    ChessArray entries;
+    size_t max_entries;
+    ChessHashFileRuns runs; /* entries spilled from the array */
+} ChessPositionIndexBuilder;
+
+/* Once the entries would take more than max_memory bytes, they're written
+ * out to temporary files, which are merged when saving */
+void chess_position_index_builder_init(ChessPositionIndexBuilder*, size_t max_memory);
+void chess_position_index_builder_cleanup(ChessPositionIndexBuilder*);
+
+/* Adds every position in the game's mainline, starting with the initial
+ * one at ply 0, loading any deferred moves first. Returns CHESS_FALSE,
+ * adding nothing, if they don't all load. Game ids are up to the caller,
+ * such as the game's place in an archive. */
+ChessBoolean chess_position_index_builder_add_game(ChessPositionIndexBuilder*,
+    ChessGame*, uint32_t game_id);
+
+/* Returns CHESS_FALSE if the file couldn't be written. The builder can be
+ * added to and saved again afterwards. */
+ChessBoolean chess_position_index_builder_save(ChessPositionIndexBuilder*, const char* filename);
+
+typedef struct
+{
+    ChessHashFile file;
+    const ChessPositionIndexEntry* entries;
+    size_t num_entries;
+} ChessPositionIndex;
+
+/* Returns CHESS_FALSE if the file can't be mapped or isn't an index */
+ChessBoolean chess_position_index_init(ChessPositionIndex*, const char* filename);
+void chess_position_index_cleanup(ChessPositionIndex*);
+
+/* Points entries at the matches, ordered by game then ply, and returns how
+ * many there are */
+size_t chess_position_index_find(const ChessPositionIndex*, ChessHash,
+    const ChessPositionIndexEntry** entries);
+/* Returns 0 if the FEN isn't valid */
+size_t chess_position_index_find_fen(const ChessPositionIndex*, const char* fen,
+    const ChessPositionIndexEntry** entries);
+
+#endif /* CHESSLIB_POSITION_INDEX_H_ */
@@ -14,6 +14,26 @@ void chess_position_copy(const ChessPosition* from, ChessPosition* to)
     memcpy(to, from, sizeof(ChessPosition));
 }
 
+static ChessHash state_hash(const ChessPosition* position)
+{
+    ChessHash hash = chess_zobrist_keys.castle[position->castle];
+    ChessColor color = position->to_move;
+    ChessPiece pawn = chess_piece_of_color(CHESS_PIECE_WHITE_PAWN, color);
+    ChessSquare sq;
+
+    if (color == CHESS_COLOR_BLACK)
+        hash ^= chess_zobrist_keys.black_to_move;
+
+    if (position->ep != CHESS_FILE_INVALID)
+    {
+        sq = chess_square_from_fr(position->ep, (color == CHESS_COLOR_WHITE) ? CHESS_RANK_5 : CHESS_RANK_4);
+        if ((position->ep > CHESS_FILE_A && position->piece[sq - 1] == pawn)
+            || (position->ep < CHESS_FILE_H && position->piece[sq + 1] == pawn))
+            hash ^= chess_zobrist_keys.ep[position->ep];
+    }
+    return hash;
+}
+
 ChessBoolean chess_position_validate(ChessPosition* position)
 {
     ChessSquare sq, other_king;
@@ -24,10 +44,20 @@ ChessBoolean chess_position_validate(ChessPosition* position)
     chess_position_copy(position, &temp_position);
     temp_position.wking = CHESS_SQUARE_INVALID;
     temp_position.bking = CHESS_SQUARE_INVALID;
+    memset(temp_position.bitboards, 0, sizeof(temp_position.bitboards));
+    memset(temp_position.occupied, 0, sizeof(temp_position.occupied));
+    temp_position.hash = 0;
 
     for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; ++sq)
     {
         pc = position->piece[sq];
+        if (pc != CHESS_PIECE_NONE)
+        {
+            temp_position.bitboards[pc] |= CHESS_BITBOARD_SQUARE(sq);
+            temp_position.occupied[chess_piece_color(pc)] |= CHESS_BITBOARD_SQUARE(sq);
+            temp_position.hash ^= chess_zobrist_keys.piece[pc][sq];
+        }
+
         if (pc == CHESS_PIECE_WHITE_KING)
         {
             if (temp_position.wking != CHESS_SQUARE_INVALID)
@@ -108,10 +138,16 @@ ChessBoolean chess_position_validate(ChessPosition* position)
     }
 
     /* All checks passed! */
+    temp_position.hash ^= state_hash(&temp_position);
     chess_position_copy(&temp_position, position);
     return CHESS_TRUE;
 }
 
+ChessHash chess_position_hash(const ChessPosition* position)
+{
+    return position->hash;
+}
+
 ChessBoolean chess_position_is_check(const ChessPosition* position)
 {
     if (position->to_move == CHESS_COLOR_WHITE)
@@ -122,16 +158,29 @@ ChessBoolean chess_position_is_check(const ChessPosition* position)
 
 ChessBoolean chess_position_move_is_legal(const ChessPosition* position, ChessMove move)
 {
-    ChessMoveGenerator generator;
-    ChessMove legalMove;
+    ChessSquare from = chess_move_from(move), to = chess_move_to(move);
+    ChessPiece piece = position->piece[from];
+    ChessMovePromote promote = chess_move_promotes(move);
+    ChessRank rank = chess_square_rank(to);
+
+    if (piece == CHESS_PIECE_NONE || chess_piece_color(piece) != position->to_move)
+        return CHESS_FALSE;
 
-    chess_move_generator_init(&generator, position);
-    while ((legalMove = chess_move_generator_next(&generator)))
+    /* Pawns promote exactly when they reach the last rank */
+    if (chess_piece_of_color(piece, CHESS_COLOR_WHITE) == CHESS_PIECE_WHITE_PAWN
+        && (rank == CHESS_RANK_1 || rank == CHESS_RANK_8))
     {
-        if (legalMove == move)
-            return CHESS_TRUE;
+        if (promote < CHESS_MOVE_PROMOTE_KNIGHT || promote > CHESS_MOVE_PROMOTE_QUEEN
+            || move != chess_move_make_promote(from, to, promote))
+            return CHESS_FALSE;
+    }
+    else if (move != chess_move_make(from, to))
+    {
+        return CHESS_FALSE;
     }
-    return CHESS_FALSE;
+
+    return (chess_generate_origins(position, piece, to) & CHESS_BITBOARD_SQUARE(from))
+        && chess_generate_move_is_legal(position, move);
 }
 
 ChessBoolean chess_position_move_is_capture(const ChessPosition* position, ChessMove move)
@@ -148,10 +197,7 @@ ChessBoolean chess_position_move_is_capture(const ChessPosition* position, Chess
 
 ChessResult chess_position_check_result(const ChessPosition* position)
 {
-    ChessMoveGenerator generator;
-
-    chess_move_generator_init(&generator, position);
-    if (chess_move_generator_next(&generator) > 0)
+    if (chess_generate_has_legal_move(position))
         return CHESS_RESULT_NONE;
 
     if (!chess_position_is_check(position))
@@ -206,6 +252,34 @@ static ChessPiece promoted_piece(ChessMovePromote promote, ChessColor color)
     }
 }
 
+static void put_piece(ChessPosition* position, ChessSquare sq, ChessPiece piece)
+{
+    ChessBitboard bb = CHESS_BITBOARD_SQUARE(sq);
+    assert(position->piece[sq] == CHESS_PIECE_NONE);
+    position->piece[sq] = piece;
+    position->bitboards[piece] |= bb;
+    position->occupied[chess_piece_color(piece)] |= bb;
+    position->hash ^= chess_zobrist_keys.piece[piece][sq];
+}
+
+static void remove_piece(ChessPosition* position, ChessSquare sq)
+{
+    ChessPiece piece = position->piece[sq];
+    ChessBitboard bb = CHESS_BITBOARD_SQUARE(sq);
+    assert(piece != CHESS_PIECE_NONE);
+    position->piece[sq] = CHESS_PIECE_NONE;
+    position->bitboards[piece] &= ~bb;
+    position->occupied[chess_piece_color(piece)] &= ~bb;
+    position->hash ^= chess_zobrist_keys.piece[piece][sq];
+}
+
+static void move_piece(ChessPosition* position, ChessSquare from, ChessSquare to)
+{
+    ChessPiece piece = position->piece[from];
+    remove_piece(position, from);
+    put_piece(position, to, piece);
+}
+
 ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
 {
     ChessSquare from = chess_move_from(move);
@@ -218,6 +292,9 @@ ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
     ChessCastleState castle = position->castle;
     int fifty = position->fifty;
 
+    /* The pieces update the hash as they move, the rest is swapped at the end */
+    position->hash ^= state_hash(position);
+
     /* Move the piece */
     if (move == CHESS_MOVE_NULL)
     {
@@ -229,10 +306,13 @@ ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
         piece = position->piece[from];
         captured = capture_piece(position->piece[to]);
 
-        position->piece[from] = CHESS_PIECE_NONE;
+        if (captured != CHESS_UNMOVE_CAPTURED_NONE)
+            remove_piece(position, to);
+
+        remove_piece(position, from);
         if (promote == CHESS_MOVE_PROMOTE_NONE)
         {
-            position->piece[to] = piece;
+            put_piece(position, to, piece);
             if (piece == CHESS_PIECE_WHITE_KING)
                 position->wking = to;
             else if (piece == CHESS_PIECE_BLACK_KING)
@@ -240,35 +320,23 @@ ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
         }
         else
         {
-            position->piece[to] = promoted_piece(promote, color);
+            put_piece(position, to, promoted_piece(promote, color));
         }
 
         /* Handle castling */
         if (piece == CHESS_PIECE_WHITE_KING && from == CHESS_SQUARE_E1)
         {
             if (to == CHESS_SQUARE_G1)
-            {
-                position->piece[CHESS_SQUARE_F1] = CHESS_PIECE_WHITE_ROOK;
-                position->piece[CHESS_SQUARE_H1] = CHESS_PIECE_NONE;
-            }
+                move_piece(position, CHESS_SQUARE_H1, CHESS_SQUARE_F1);
             else if (to == CHESS_SQUARE_C1)
-            {
-                position->piece[CHESS_SQUARE_D1] = CHESS_PIECE_WHITE_ROOK;
-                position->piece[CHESS_SQUARE_A1] = CHESS_PIECE_NONE;
-            }
+                move_piece(position, CHESS_SQUARE_A1, CHESS_SQUARE_D1);
         }
         else if (piece == CHESS_PIECE_BLACK_KING && from == CHESS_SQUARE_E8)
         {
             if (to == CHESS_SQUARE_G8)
-            {
-                position->piece[CHESS_SQUARE_F8] = CHESS_PIECE_BLACK_ROOK;
-                position->piece[CHESS_SQUARE_H8] = CHESS_PIECE_NONE;
-            }
+                move_piece(position, CHESS_SQUARE_H8, CHESS_SQUARE_F8);
             else if (to == CHESS_SQUARE_C8)
-            {
-                position->piece[CHESS_SQUARE_D8] = CHESS_PIECE_BLACK_ROOK;
-                position->piece[CHESS_SQUARE_A8] = CHESS_PIECE_NONE;
-            }
+                move_piece(position, CHESS_SQUARE_A8, CHESS_SQUARE_D8);
         }
 
         /* Check if castling availability was lost */
@@ -305,12 +373,12 @@ ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
     {
         if (piece == CHESS_PIECE_WHITE_PAWN && to == chess_square_from_fr(position->ep, CHESS_RANK_6))
         {
-            position->piece[chess_square_from_fr(position->ep, CHESS_RANK_5)] = CHESS_PIECE_NONE;
+            remove_piece(position, chess_square_from_fr(position->ep, CHESS_RANK_5));
             ep = CHESS_UNMOVE_EP_CAPTURE;
         }
         else if (piece == CHESS_PIECE_BLACK_PAWN && to == chess_square_from_fr(position->ep, CHESS_RANK_3))
         {
-            position->piece[chess_square_from_fr(position->ep, CHESS_RANK_4)] = CHESS_PIECE_NONE;
+            remove_piece(position, chess_square_from_fr(position->ep, CHESS_RANK_4));
             ep = CHESS_UNMOVE_EP_CAPTURE;
         }
         else
@@ -339,6 +407,8 @@ ChessUnmove chess_position_make_move(ChessPosition* position, ChessMove move)
     if (position->to_move == CHESS_COLOR_WHITE)
         position->move_num++;
 
+    position->hash ^= state_hash(position);
+
     return chess_unmove_make(from, to, captured,
         promote != CHESS_MOVE_PROMOTE_NONE, ep, castle, fifty);
 }
@@ -377,6 +447,8 @@ void chess_position_undo_move(ChessPosition* position, ChessUnmove unmove)
     ChessColor color = chess_color_other(other);
     ChessFile file;
 
+    position->hash ^= state_hash(position);
+
     if (from == 0 && to == 0)
     {
         /* Null move */
@@ -391,35 +463,25 @@ void chess_position_undo_move(ChessPosition* position, ChessUnmove unmove)
         assert(color == chess_piece_color(piece));
 
         /* Unmove the piece */
-        position->piece[from] = piece;
-        position->piece[to] = captured_piece(captured, other);
+        remove_piece(position, to);
+        put_piece(position, from, piece);
+        if (captured != CHESS_UNMOVE_CAPTURED_NONE)
+            put_piece(position, to, captured_piece(captured, other));
 
         /* Handle castling */
         if (piece == CHESS_PIECE_WHITE_KING && from == CHESS_SQUARE_E1)
         {
             if (to == CHESS_SQUARE_G1)
-            {
-                position->piece[CHESS_SQUARE_F1] = CHESS_PIECE_NONE;
-                position->piece[CHESS_SQUARE_H1] = CHESS_PIECE_WHITE_ROOK;
-            }
+                move_piece(position, CHESS_SQUARE_F1, CHESS_SQUARE_H1);
             else if (to == CHESS_SQUARE_C1)
-            {
-                position->piece[CHESS_SQUARE_D1] = CHESS_PIECE_NONE;
-                position->piece[CHESS_SQUARE_A1] = CHESS_PIECE_WHITE_ROOK;
-            }
+                move_piece(position, CHESS_SQUARE_D1, CHESS_SQUARE_A1);
         }
         else if (piece == CHESS_PIECE_BLACK_KING && from == CHESS_SQUARE_E8)
         {
             if (to == CHESS_SQUARE_G8)
-            {
-                position->piece[CHESS_SQUARE_F8] = CHESS_PIECE_NONE;
-                position->piece[CHESS_SQUARE_H8] = CHESS_PIECE_BLACK_ROOK;
-            }
+                move_piece(position, CHESS_SQUARE_F8, CHESS_SQUARE_H8);
             else if (to == CHESS_SQUARE_C8)
-            {
-                position->piece[CHESS_SQUARE_D8] = CHESS_PIECE_NONE;
-                position->piece[CHESS_SQUARE_A8] = CHESS_PIECE_BLACK_ROOK;
-            }
+                move_piece(position, CHESS_SQUARE_D8, CHESS_SQUARE_A8);
         }
         position->castle = chess_unmove_castle(unmove);
     }
@@ -436,9 +498,9 @@ void chess_position_undo_move(ChessPosition* position, ChessUnmove unmove)
         /* Restore the captured pawn */
         file = chess_square_file(to);
         if (color == CHESS_COLOR_WHITE)
-            position->piece[chess_square_from_fr(file, CHESS_RANK_5)] = CHESS_PIECE_BLACK_PAWN;
+            put_piece(position, chess_square_from_fr(file, CHESS_RANK_5), CHESS_PIECE_BLACK_PAWN);
         else
-            position->piece[chess_square_from_fr(file, CHESS_RANK_4)] = CHESS_PIECE_WHITE_PAWN;
+            put_piece(position, chess_square_from_fr(file, CHESS_RANK_4), CHESS_PIECE_WHITE_PAWN);
         position->ep = file;
     }
     else
@@ -458,4 +520,6 @@ void chess_position_undo_move(ChessPosition* position, ChessUnmove unmove)
     position->to_move = color;
     if (position->to_move == CHESS_COLOR_BLACK)
         position->move_num--;
+
+    position->hash ^= state_hash(position);
 }
@@ -2,8 +2,10 @@
 #define CHESSLIB_POSITION_H_
 
 #include "chess.h"
+#include "bitboard.h"
 #include "move.h"
 #include "unmove.h"
+#include "zobrist.h"
 
 typedef struct
 {
@@ -16,6 +18,9 @@ typedef struct
     int move_num;
     /* The remaining members are private and should not be used. */
     ChessSquare wking, bking;
+    ChessBitboard bitboards[14]; /* indexed by ChessPiece */
+    ChessBitboard occupied[2]; /* indexed by ChessColor */
+    ChessHash hash;
 } ChessPosition;
 
 void chess_position_copy(const ChessPosition* from, ChessPosition* to);
@@ -34,6 +39,11 @@ void chess_position_copy(const ChessPosition* from, ChessPosition* to);
  */
 ChessBoolean chess_position_validate(ChessPosition*);
 
+/* The Zobrist key of the pieces, side to move, castle rights and en passant
+ * file. The en passant file only counts when a pawn is beside the one that
+ * just moved, so positions that play the same hash the same. */
+ChessHash chess_position_hash(const ChessPosition*);
+
 ChessBoolean chess_position_is_check(const ChessPosition*);
 ChessBoolean chess_position_move_is_legal(const ChessPosition*, ChessMove);
 ChessBoolean chess_position_move_is_capture(const ChessPosition*, ChessMove);
@@ -27,27 +27,26 @@ int chess_print_move(ChessMove move, char* s)
     return n;
 }
 
-int chess_print_move_san(ChessMove move, const ChessPosition* position, char* s)
+/* Everything but the check or mate symbol, which needs the move made */
+static int print_san_move(ChessMove move, const ChessPosition* position, char* s)
 {
     ChessSquare from = chess_move_from(move);
     ChessSquare to = chess_move_to(move);
     ChessMovePromote promote = chess_move_promotes(move);
     ChessPiece piece;
-    ChessMoveGenerator generator;
-    ChessMove move2;
+    ChessBitboard others;
     ChessBoolean capture;
     ChessBoolean piece_ambiguous = CHESS_FALSE;
     ChessBoolean file_ambiguous = CHESS_FALSE, rank_ambiguous = CHESS_FALSE;
     ChessSquare sq;
     ChessFile file;
     ChessRank rank;
-    ChessPosition temp_position;
     size_t n = 0;
 
     /* Check for null move */
     if (move == CHESS_MOVE_NULL)
     {
-        strcpy(s, "--");
+        s[0] = s[1] = '-';
         return 2;
     }
 
@@ -60,12 +59,12 @@ int chess_print_move_san(ChessMove move, const ChessPosition* position, char* s)
     {
         if (chess_square_file(to) == CHESS_FILE_G)
         {
-            strcpy(s, "O-O");
+            memcpy(s, "O-O", 3);
             return 3;
         }
         if (chess_square_file(to) == CHESS_FILE_C)
         {
-            strcpy(s, "O-O-O");
+            memcpy(s, "O-O-O", 5);
             return 5;
         }
     }
@@ -83,23 +82,17 @@ int chess_print_move_san(ChessMove move, const ChessPosition* position, char* s)
     {
         s[n++] = toupper(chess_piece_to_char(piece));
 
-        /* Need to examine legal moves to determine ambiguity */
-        chess_move_generator_init(&generator, position);
-
+        /* Only other pieces of the same kind that can legally reach the
+         * square make it ambiguous */
         file = chess_square_file(from);
         rank = chess_square_rank(from);
-
-        while ((move2 = chess_move_generator_next(&generator)))
+        others = chess_generate_origins(position, piece, to) & ~CHESS_BITBOARD_SQUARE(from);
+        while (others)
         {
-            if (chess_move_to(move2) != to)
+            sq = chess_bitboard_pop(&others);
+            if (!chess_generate_move_is_legal(position, chess_move_make(sq, to)))
                 continue;
 
-            sq = chess_move_from(move2);
-            if (sq == from)
-                continue; /* same move */
-            if (position->piece[sq] != piece)
-                continue; /* different piece */
-
             piece_ambiguous = CHESS_TRUE;
             if (chess_square_file(sq) == file)
                 file_ambiguous = CHESS_TRUE;
@@ -138,17 +131,29 @@ int chess_print_move_san(ChessMove move, const ChessPosition* position, char* s)
         s[n++] = chars[promote];
     }
 
-    /* Add check or mate symbol */
-    chess_position_copy(position, &temp_position);
-    chess_position_make_move(&temp_position, move);
-    if (chess_position_is_check(&temp_position))
+    return n;
+}
+
+/* The symbol for the position a move led to, if it's check */
+static int print_san_check(const ChessPosition* position, char* s)
+{
+    if (!chess_position_is_check(position))
+        return 0;
+    s[0] = chess_generate_has_legal_move(position) ? '+' : '#';
+    return 1;
+}
+
+int chess_print_move_san(ChessMove move, const ChessPosition* position, char* s)
+{
+    ChessPosition temp_position;
+    int n = print_san_move(move, position, s);
+
+    if (move != CHESS_MOVE_NULL)
     {
-        if (chess_position_check_result(&temp_position) == CHESS_RESULT_NONE)
-            s[n++] = '+';
-        else
-            s[n++] = '#';
+        chess_position_copy(position, &temp_position);
+        chess_position_make_move(&temp_position, move);
+        n += print_san_check(&temp_position, s + n);
     }
-
     s[n] = '\0';
     return n;
 }
@@ -199,6 +204,42 @@ int chess_print_position(const ChessPosition* position, char* s)
     return n;
 }
 
+/* Game moves are gathered here and handed to the writer in large pieces */
+typedef struct
+{
+    ChessWriter* writer;
+    ChessPosition position; /* moves are made and undone as the game is walked */
+    ChessArray unmoves;
+    size_t size;
+    char data[4096];
+} GamePrinter;
+
+/* Enough for a move number, a move and its annotations */
+#define GAME_PRINTER_MAX_MOVE 64
+
+static char* game_printer_reserve(GamePrinter* printer, size_t n)
+{
+    if (printer->size + n > sizeof(printer->data))
+    {
+        chess_writer_write_string_size(printer->writer, printer->data, printer->size);
+        printer->size = 0;
+    }
+    return printer->data + printer->size;
+}
+
+static void game_printer_write(GamePrinter* printer, const char* s, size_t n)
+{
+    memcpy(game_printer_reserve(printer, n), s, n);
+    printer->size += n;
+}
+
+static void game_printer_flush(GamePrinter* printer)
+{
+    if (printer->size > 0)
+        chess_writer_write_string_size(printer->writer, printer->data, printer->size);
+    printer->size = 0;
+}
+
 static int print_nags(const ChessVariation* variation, char* s)
 {
     ChessAnnotation annotations[4];
@@ -210,73 +251,153 @@ static int print_nags(const ChessVariation* variation, char* s)
     return n;
 }
 
-static void print_variation(const ChessPosition* position, ChessVariation* variation, ChessWriter* writer)
+static void make_game_move(GamePrinter* printer, ChessMove move)
 {
-    ChessMove move;
-    ChessPosition temp_position;
-    ChessVariation* alternate;
-    ChessBoolean showBlackNum = CHESS_TRUE, showSep = CHESS_FALSE;
-    char buf[32];
-    size_t n;
+    ChessUnmove unmove = chess_position_make_move(&printer->position, move);
+    chess_array_push(&printer->unmoves, &unmove);
+}
 
-    chess_position_copy(position, &temp_position);
+/* Goes back to the position from before the moves made since depth */
+static void undo_game_moves(GamePrinter* printer, size_t depth)
+{
+    ChessUnmove unmove;
+
+    while (chess_array_size(&printer->unmoves) > depth)
+    {
+        chess_array_pop(&printer->unmoves, &unmove);
+        chess_position_undo_move(&printer->position, unmove);
+    }
+}
+
+/* Much quicker than sprintf, which would otherwise cost more than the move */
+static size_t print_move_number(int number, ChessBoolean black, char* s)
+{
+    char digits[16];
+    size_t n = 0, i = 0;
 
     do
     {
-        if (showSep)
-            chess_writer_write_char(writer, ' ');
-
-        n = 0;
-        if (temp_position.to_move == CHESS_COLOR_WHITE)
-            n = sprintf(buf, "%d. ", temp_position.move_num);
-        else if (showBlackNum)
-            n = sprintf(buf, "%d... ", temp_position.move_num);
-
-        move = variation->move;
-        n += chess_print_move_san(move, &temp_position, buf + n);
-        n += print_nags(variation, buf + n);
-        chess_writer_write_string_size(writer, buf, n);
-        showBlackNum = CHESS_FALSE;
-
-        if (variation->left == NULL)
+        digits[i++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+    while (i > 0)
+        s[n++] = digits[--i];
+
+    s[n++] = '.';
+    if (black)
+    {
+        s[n++] = '.';
+        s[n++] = '.';
+    }
+    s[n++] = ' ';
+    return n;
+}
+
+/* Prints the move and makes it */
+static void print_game_move(GamePrinter* printer, ChessMove move,
+    ChessBoolean show_black_num, const ChessVariation* variation)
+{
+    ChessPosition* position = &printer->position;
+    char* s = game_printer_reserve(printer, GAME_PRINTER_MAX_MOVE);
+    size_t n = 0;
+
+    if (position->to_move == CHESS_COLOR_WHITE || show_black_num)
+        n = print_move_number(position->move_num, position->to_move == CHESS_COLOR_BLACK, s);
+
+    n += print_san_move(move, position, s + n);
+    make_game_move(printer, move);
+    if (move != CHESS_MOVE_NULL)
+        n += print_san_check(position, s + n);
+    if (variation != NULL)
+        n += print_nags(variation, s + n);
+    printer->size += n;
+}
+
+/* Leaves the line's moves made, for the caller to undo if it needs to */
+static void print_variation(GamePrinter* printer, const ChessVariation* variation)
+{
+    ChessVariation* alternate;
+    ChessBoolean show_black_num = CHESS_TRUE, show_sep = CHESS_FALSE;
+    size_t depth;
+
+    do
+    {
+        if (show_sep)
+            game_printer_write(printer, " ", 1);
+
+        print_game_move(printer, variation->move, show_black_num, variation);
+        show_black_num = CHESS_FALSE;
+
+        if (variation->left == NULL && variation->right != NULL)
         {
+            /* The alternatives start from before the move */
+            undo_game_moves(printer, chess_array_size(&printer->unmoves) - 1);
+            depth = chess_array_size(&printer->unmoves);
             for (alternate = variation->right;
                  alternate != NULL; alternate = alternate->right)
             {
-                chess_writer_write_string(writer, " (");
-                print_variation(&temp_position, alternate, writer);
-                chess_writer_write_char(writer, ')');
-                showBlackNum = CHESS_TRUE;
+                game_printer_write(printer, " (", 2);
+                print_variation(printer, alternate);
+                game_printer_write(printer, ")", 1);
+                undo_game_moves(printer, depth);
             }
+            make_game_move(printer, variation->move);
+            show_black_num = CHESS_TRUE;
         }
 
-        chess_position_make_move(&temp_position, move);
-        showSep = CHESS_TRUE;
+        show_sep = CHESS_TRUE;
     } while ((variation = variation->first_child) != NULL);
 }
 
+static void print_mainline(GamePrinter* printer, const ChessGame* game)
+{
+    size_t ply = chess_game_ply(game), i;
+
+    for (i = 0; i < ply; i++)
+    {
+        print_game_move(printer, chess_game_move_at_ply(game, i), i == 0, NULL);
+        game_printer_write(printer, " ", 1);
+    }
+}
+
+/* Walks the game with one position, making and undoing the moves, so each
+ * move is only made once and its check is found from the position after */
 void chess_print_game_moves(const ChessGame* game, ChessWriter* writer)
 {
-    const ChessPosition* position;
-    ChessVariation* variation;
+    GamePrinter printer;
+    const ChessVariation* variation;
     ChessResult result;
-    char buf[10];
-    size_t n;
+    char* s;
 
-    position = chess_game_initial_position(game);
-    variation = chess_game_root_variation(game);
-    variation = variation->first_child;
-    if (variation != NULL)
+    printer.writer = writer;
+    printer.size = 0;
+    chess_position_copy(chess_game_initial_position(game), &printer.position);
+    chess_array_init(&printer.unmoves, sizeof(ChessUnmove));
+
+    if (chess_game_is_compact(game))
     {
-        print_variation(position, variation, writer);
-        chess_writer_write_char(writer, ' ');
+        /* No need to make a tree just to print it */
+        print_mainline(&printer, game);
+    }
+    else
+    {
+        variation = chess_game_tree(game);
+        variation = variation->first_child;
+        if (variation != NULL)
+        {
+            print_variation(&printer, variation);
+            game_printer_write(&printer, " ", 1);
+        }
     }
 
     result = chess_game_result(game);
     if (result == CHESS_RESULT_NONE)
         result = CHESS_RESULT_IN_PROGRESS;
-    n = chess_print_result(result, buf);
-    chess_writer_write_string_size(writer, buf, n);
+    s = game_printer_reserve(&printer, 8);
+    printer.size += chess_print_result(result, s);
+    game_printer_flush(&printer);
+
+    chess_array_cleanup(&printer.unmoves);
 }
 
 int chess_print_result(ChessResult result, char* s)
@@ -2,15 +2,23 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "reader.h"
 #include "calloc.h"
 
 typedef int(*ReadCharFunc)(ChessReader*);
+typedef size_t(*SpanFunc)(ChessReader*, const char** data);
+typedef void(*SkipFunc)(ChessReader*, size_t count);
 
 typedef struct
 {
     ReadCharFunc read_char;
+    SpanFunc span; /* optional */
+    SkipFunc skip; /* optional */
 } ReaderVtable;
 
 void chess_reader_init(ChessReader* reader)
@@ -40,9 +48,27 @@ int chess_reader_peek(ChessReader* reader)
     return reader->next;
 }
 
-void chess_reader_ungetc(ChessReader* reader, char c)
+void chess_reader_ungetc(ChessReader* reader, int c)
 {
-    reader->next = c;
+    reader->next = (c == EOF) ? EOF : (unsigned char)c;
+}
+
+size_t chess_reader_span(ChessReader* reader, const char** data)
+{
+    ReaderVtable* vtable = (ReaderVtable*)reader->vtable;
+    if (vtable->span == NULL || reader->next != EOF)
+    {
+        *data = NULL;
+        return 0;
+    }
+    return vtable->span(reader, data);
+}
+
+void chess_reader_skip(ChessReader* reader, size_t count)
+{
+    ReaderVtable* vtable = (ReaderVtable*)reader->vtable;
+    assert(vtable->skip != NULL && reader->next == EOF);
+    vtable->skip(reader, count);
 }
 
 static int file_reader_getc(ChessFileReader* reader)
@@ -51,7 +77,9 @@ static int file_reader_getc(ChessFileReader* reader)
 }
 
 static ReaderVtable file_reader_vtable = {
-    (ReadCharFunc)&file_reader_getc
+    (ReadCharFunc)&file_reader_getc,
+    NULL,
+    NULL
 };
 
 void chess_file_reader_init(ChessFileReader* reader, FILE* file)
@@ -69,11 +97,25 @@ void chess_file_reader_cleanup(ChessFileReader* writer)
 static int buffer_reader_getc(ChessBufferReader* reader)
 {
     return (reader->index < reader->buffer_size)
-        ? reader->buffer[reader->index++] : EOF;
+        ? (unsigned char)reader->buffer[reader->index++] : EOF;
+}
+
+static size_t buffer_reader_span(ChessBufferReader* reader, const char** data)
+{
+    *data = reader->buffer + reader->index;
+    return reader->buffer_size - reader->index;
+}
+
+static void buffer_reader_skip(ChessBufferReader* reader, size_t count)
+{
+    assert(count <= reader->buffer_size - reader->index);
+    reader->index += count;
 }
 
 static ReaderVtable buffer_reader_vtable = {
-    (ReadCharFunc)&buffer_reader_getc
+    (ReadCharFunc)&buffer_reader_getc,
+    (SpanFunc)&buffer_reader_span,
+    (SkipFunc)&buffer_reader_skip
 };
 
 void chess_buffer_reader_init(ChessBufferReader* reader, const char* str)
@@ -95,3 +137,86 @@ void chess_buffer_reader_cleanup(ChessBufferReader* reader)
 {
     chess_free(reader->buffer);
 }
+
+static int mapped_reader_getc(ChessMappedReader* reader)
+{
+    return (reader->index < reader->size)
+        ? (unsigned char)reader->data[reader->index++] : EOF;
+}
+
+static size_t mapped_reader_span(ChessMappedReader* reader, const char** data)
+{
+    *data = reader->data + reader->index;
+    return reader->size - reader->index;
+}
+
+static void mapped_reader_skip(ChessMappedReader* reader, size_t count)
+{
+    assert(count <= reader->size - reader->index);
+    reader->index += count;
+}
+
+static ReaderVtable mapped_reader_vtable = {
+    (ReadCharFunc)&mapped_reader_getc,
+    (SpanFunc)&mapped_reader_span,
+    (SkipFunc)&mapped_reader_skip
+};
+
+void chess_mapped_reader_init_data(ChessMappedReader* reader, const char* data, size_t size)
+{
+    chess_reader_init((ChessReader*)reader);
+    reader->base.vtable = &mapped_reader_vtable;
+    reader->data = data;
+    reader->size = size;
+    reader->index = 0;
+    reader->mapped = CHESS_FALSE;
+}
+
+ChessBoolean chess_mapped_reader_init(ChessMappedReader* reader, const char* filename)
+{
+    struct stat st;
+    void* data;
+    int fd;
+
+    chess_mapped_reader_init_data(reader, NULL, 0);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return CHESS_FALSE;
+
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return CHESS_FALSE;
+    }
+
+    /* An empty file can't be mapped, but reads fine as nothing */
+    if (st.st_size > 0)
+    {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return CHESS_FALSE;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+        reader->data = data;
+        reader->size = (size_t)st.st_size;
+        reader->mapped = CHESS_TRUE;
+    }
+
+    /* The mapping stays valid after the file is closed */
+    close(fd);
+    return CHESS_TRUE;
+}
+
+void chess_mapped_reader_cleanup(ChessMappedReader* reader)
+{
+    if (reader->mapped)
+        munmap((void*)reader->data, reader->size);
+    reader->data = NULL;
+    reader->size = 0;
+    reader->mapped = CHESS_FALSE;
+}
@@ -1,6 +1,11 @@
 #ifndef CHESSLIB_READER_H_
 #define CHESSLIB_READER_H_
 
+#include <stddef.h>
+#include <stdio.h>
+
+#include "chess.h"
+
 typedef struct
 {
     void* vtable;
@@ -9,7 +14,18 @@ typedef struct
 
 int chess_reader_getc(ChessReader*);
 int chess_reader_peek(ChessReader*);
-void chess_reader_ungetc(ChessReader*, char);
+/* Takes a character as returned by getc, so pushing back EOF leaves the
+ * reader as it was */
+void chess_reader_ungetc(ChessReader*, int);
+
+/* Readers over memory can lend out everything they have left in one go.
+ * Returns the number of bytes available at *data, which is set to NULL if
+ * the reader can't (or has a character pushed back). Nothing is consumed
+ * until skip is called with the number of bytes used. The buffer and mapped
+ * readers keep their bytes in place until cleanup, so pointers into a span
+ * stay valid. */
+size_t chess_reader_span(ChessReader*, const char** data);
+void chess_reader_skip(ChessReader*, size_t count);
 
 typedef struct
 {
@@ -32,4 +48,21 @@ void chess_buffer_reader_init(ChessBufferReader*, const char* str);
 void chess_buffer_reader_init_size(ChessBufferReader*, const char* data, size_t size);
 void chess_buffer_reader_cleanup(ChessBufferReader*);
 
+/* Reads a file through a read-only memory mapping, without copying it */
+typedef struct
+{
+    ChessReader base;
+    const char* data;
+    size_t size;
+    size_t index;
+    ChessBoolean mapped;
+} ChessMappedReader;
+
+/* Returns CHESS_FALSE if the file can't be opened or mapped */
+ChessBoolean chess_mapped_reader_init(ChessMappedReader*, const char* filename);
+/* Reads memory that is already mapped (or otherwise owned by the caller)
+ * and must outlive the reader */
+void chess_mapped_reader_init_data(ChessMappedReader*, const char* data, size_t size);
+void chess_mapped_reader_cleanup(ChessMappedReader*);
+
 #endif /* CHESSLIB_READER_H_ */
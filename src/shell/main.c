@@ -9,6 +9,7 @@
 #include "../parse.h"
 #include "../print.h"
 #include "../fen.h"
+#include "../opening-tree.h"
 #include "../pgn.h"
 
 static char* read_line(const char* prompt)
@@ -89,6 +90,38 @@ static void print_board(const ChessGameIterator* iter)
     fputs(buf, stdout);
 }
 
+static void open_tree(ChessOpeningTree* tree, ChessBoolean* open, const char* filename)
+{
+    if (*open)
+    {
+        chess_opening_tree_cleanup(tree);
+        *open = CHESS_FALSE;
+    }
+
+    if (!chess_opening_tree_init(tree, filename))
+    {
+        printf("Error (can't open tree): %s\n", filename);
+        return;
+    }
+    *open = CHESS_TRUE;
+}
+
+static void explore_tree(const ChessOpeningTree* tree, const ChessGameIterator* iter)
+{
+    const ChessOpeningTreeMove* moves;
+    size_t n, i;
+    char buf[16];
+
+    n = chess_opening_tree_find(tree, chess_position_hash(&iter->position), &moves);
+    for (i = 0; i < n; i++)
+    {
+        chess_print_move_san(moves[i].move, &iter->position, buf);
+        printf("%-8s %8lu  +%lu =%lu -%lu  %u\n", buf, (unsigned long)moves[i].games,
+            (unsigned long)moves[i].white_wins, (unsigned long)moves[i].draws,
+            (unsigned long)moves[i].black_wins, chess_opening_tree_move_average_elo(&moves[i]));
+    }
+}
+
 static void load_fen(ChessGame* game, const char* fen)
 {
     ChessGameIterator iter;
@@ -279,6 +312,8 @@ int main (int argc, const char* argv[])
     char *line, *cmd, *args;
     ChessGame* game;
     ChessGameIterator iter;
+    ChessOpeningTree tree;
+    ChessBoolean tree_open = CHESS_FALSE;
     int quit = 0;
 
     chess_generate_init();
@@ -364,12 +399,25 @@ int main (int argc, const char* argv[])
         {
             set_result(game, args);
         }
+        else if (!strcmp(cmd, "tree"))
+        {
+            open_tree(&tree, &tree_open, args);
+        }
+        else if (!strcmp(cmd, "explore"))
+        {
+            if (tree_open)
+                explore_tree(&tree, &iter);
+            else
+                puts("Error: no tree open");
+        }
         else
         {
             handle_move(&iter, cmd);
         }
     }
 
+    if (tree_open)
+        chess_opening_tree_cleanup(&tree);
     chess_game_iterator_cleanup(&iter);
     chess_game_destroy(game);
 
@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <CUnit/CUnit.h>
 
@@ -91,6 +93,19 @@ void assert_positions_equal(const ChessPosition* lposition, const ChessPosition*
         }
     }
 
+    if (memcmp(lposition->bitboards, rposition->bitboards, sizeof(lposition->bitboards))
+        || memcmp(lposition->occupied, rposition->occupied, sizeof(lposition->occupied)))
+    {
+        ASSERT_FAIL("ASSERT_POSITIONS_EQUAL(bitboards)", file, line);
+        return;
+    }
+
+    if (chess_position_hash(lposition) != chess_position_hash(rposition))
+    {
+        ASSERT_FAIL("ASSERT_POSITIONS_EQUAL(hash)", file, line);
+        return;
+    }
+
     if (lposition->to_move!= rposition->to_move)
     {
         ASSERT_FAIL("ASSERT_POSITIONS_EQUAL(to_move)", file, line);
@@ -131,6 +146,25 @@ void assert_buffer_value(ChessBufferWriter* writer, const char* str, const char*
     ASSERT_IMPL(!strncmp(chess_buffer_writer_data(writer), str, size), "ASSERT_BUFFER_VALUE(value)", file, line);
 }
 
+void make_temp_file(char* filename, const char* contents)
+{
+    int fd;
+
+    strcpy(filename, "/tmp/chesslib-test-XXXXXX");
+    fd = mkstemp(filename);
+    assert(fd >= 0);
+    close(fd);
+    write_file(filename, contents);
+}
+
+void write_file(const char* filename, const char* contents)
+{
+    FILE* file = fopen(filename, "w");
+    assert(file != NULL);
+    fputs(contents, file);
+    fclose(file);
+}
+
 static int alloc_count;
 
 static int init_suite(void)
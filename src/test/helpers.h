@@ -22,10 +22,17 @@ void assert_sets_equal(const int* lset, int lsize, const int* rset, int rsize, c
 void assert_positions_equal(const ChessPosition*, const ChessPosition*, const char* file, unsigned int line);
 void assert_buffer_value(ChessBufferWriter* writer, const char* str, const char* file, unsigned int line);
 
-#define MAKE_MOVE(f,t,p) ((f) | ((t) << 6)) | ((p) << 12)
+#define MAKE_MOVE(f,t,p) (((f) | ((t) << 6)) | ((p) << 12))
 #define MV(f,t) MAKE_MOVE(CHESS_SQUARE_ ## f, CHESS_SQUARE_ ## t, CHESS_MOVE_PROMOTE_NONE)
 #define MVP(f,t,p) MAKE_MOVE(CHESS_SQUARE_ ## f, CHESS_SQUARE_ ## t, CHESS_MOVE_PROMOTE_ ## p)
 
 CU_Suite* add_suite(const char* name);
 
+/* Creates a temporary file holding contents, with its name put in filename,
+ * which needs room for TEMP_FILE_NAME_SIZE characters. Remove it with
+ * unlink. write_file replaces what a file holds. */
+#define TEMP_FILE_NAME_SIZE 32
+void make_temp_file(char* filename, const char* contents);
+void write_file(const char* filename, const char* contents);
+
 #endif /* CHESSLIB_TEST_HELPERS_H_ */
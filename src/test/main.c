@@ -20,9 +20,15 @@ void test_pgn_add_tests(void);
 void test_cstring_add_tests(void);
 void test_carray_add_tests(void);
 void test_cbuffer_add_tests(void);
+void test_carena_add_tests(void);
 void test_pgn_tokenizer_add_tests(void);
 void test_reader_add_tests(void);
 void test_writer_add_tests(void);
+void test_perft_add_tests(void);
+void test_pgn_parallel_add_tests(void);
+void test_archive_add_tests(void);
+void test_position_index_add_tests(void);
+void test_opening_tree_add_tests(void);
 
 int main(int argc, const char* argv[])
 {
@@ -44,9 +50,15 @@ int main(int argc, const char* argv[])
     test_cstring_add_tests();
     test_carray_add_tests();
     test_cbuffer_add_tests();
+    test_carena_add_tests();
     test_pgn_tokenizer_add_tests();
     test_reader_add_tests();
     test_writer_add_tests();
+    test_perft_add_tests();
+    test_pgn_parallel_add_tests();
+    test_archive_add_tests();
+    test_position_index_add_tests();
+    test_opening_tree_add_tests();
 
     CU_basic_run_tests();
 
@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+
+#include "../archive.h"
+#include "../fen.h"
+#include "../pgn.h"
+
+#include "helpers.h"
+
+static void load_pgn(const char* pgn, ChessGame* game)
+{
+    ChessBufferReader reader;
+
+    chess_buffer_reader_init(&reader, pgn);
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_load((ChessReader*)&reader, game));
+    chess_buffer_reader_cleanup(&reader);
+}
+
+static void assert_same_pgn(const ChessGame* expected, const ChessGame* game)
+{
+    ChessBufferWriter lwriter, rwriter;
+
+    chess_buffer_writer_init(&lwriter);
+    chess_buffer_writer_init(&rwriter);
+    chess_pgn_save(expected, (ChessWriter*)&lwriter);
+    chess_pgn_save(game, (ChessWriter*)&rwriter);
+    CU_ASSERT_EQUAL(chess_buffer_writer_size(&lwriter), chess_buffer_writer_size(&rwriter));
+    if (chess_buffer_writer_size(&lwriter) == chess_buffer_writer_size(&rwriter))
+    {
+        CU_ASSERT_NSTRING_EQUAL(chess_buffer_writer_data(&lwriter),
+            chess_buffer_writer_data(&rwriter), chess_buffer_writer_size(&lwriter));
+    }
+    chess_buffer_writer_cleanup(&lwriter);
+    chess_buffer_writer_cleanup(&rwriter);
+}
+
+static void test_archive_save_load(void)
+{
+    const char* pgns[] = {
+        "[Event \"Test\"]\n[White \"A\"]\n[Black \"B\"]\n[Result \"1-0\"]\n[Opening \"Ruy\"]\n\n"
+            "1. e4 e5 2. Nf3 Nc6 3. Bb5 1-0",
+        "1. e4 (1. d4 Nf6 (1... d5 2. c4)) e5 $1 2. f4 $2 $13 (2. Nf3 $20) exf4 *",
+        "[SetUp \"1\"]\n[FEN \"4k3/P7/8/8/8/8/8/4K3 w - - 0 1\"]\n\n1. a8=N Kd7 *"
+    };
+    ChessGame* games[3], *game;
+    ChessVariation* root;
+    ChessBufferWriter writer;
+    ChessBufferReader reader;
+    ChessArchiveLoader loader;
+    ChessPosition position;
+    size_t i;
+
+    chess_buffer_writer_init(&writer);
+    chess_archive_save_header((ChessWriter*)&writer);
+    for (i = 0; i < 3; i++)
+    {
+        games[i] = chess_game_new();
+        load_pgn(pgns[i], games[i]);
+        chess_archive_save(games[i], (ChessWriter*)&writer);
+    }
+
+    /* Comments aren't read from PGN yet, so add one by hand */
+    root = chess_game_root_variation(games[1]);
+    chess_variation_set_comment(root->first_child->first_child, "Best by test", 12);
+    chess_archive_save(games[1], (ChessWriter*)&writer);
+
+    chess_buffer_reader_init_size(&reader, chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&writer));
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    game = chess_game_new();
+    for (i = 0; i < 4; i++)
+    {
+        CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+        assert_same_pgn(games[i < 3 ? i : 1], game);
+    }
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_EOF, chess_archive_loader_next(&loader, game));
+
+    /* The last one has the comment, and the first stayed compact */
+    root = chess_game_root_variation(game);
+    CU_ASSERT_STRING_EQUAL("Best by test", root->first_child->first_child->comment.data);
+    CU_ASSERT_EQUAL(1, root->first_child->first_child->annotations[0]);
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_buffer_reader_init_size(&reader, chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&writer));
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    CU_ASSERT(chess_game_is_compact(game));
+    CU_ASSERT_STRING_EQUAL("Ruy", chess_game_tag_value(game, "Opening"));
+    CU_ASSERT_EQUAL(CHESS_RESULT_WHITE_WINS, chess_game_result(game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    chess_fen_load("4k3/P7/8/8/8/8/8/4K3 w - - 0 1", &position);
+    ASSERT_POSITIONS_EQUAL(&position, chess_game_initial_position(game));
+    CU_ASSERT_EQUAL(MVP(A7,A8,KNIGHT), chess_game_move_at_ply(game, 0));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_game_destroy(game);
+    for (i = 0; i < 3; i++)
+        chess_game_destroy(games[i]);
+    chess_buffer_writer_cleanup(&writer);
+}
+
+static void test_archive_corrupt(void)
+{
+    ChessGame* game = chess_game_new();
+    ChessBufferWriter writer;
+    ChessBufferReader reader;
+    ChessArchiveLoader loader;
+    char* data;
+    size_t size, first;
+
+    /* Not an archive */
+    chess_buffer_reader_init(&reader, "[Event \"PGN\"]");
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_BAD_HEADER, chess_archive_loader_next(&loader, game));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_buffer_writer_init(&writer);
+    chess_archive_save_header((ChessWriter*)&writer);
+    chess_game_append_move(game, MV(E2,E4));
+    chess_archive_save(game, (ChessWriter*)&writer);
+    first = chess_buffer_writer_size(&writer);
+    chess_game_append_move(game, MV(E7,E5));
+    chess_archive_save(game, (ChessWriter*)&writer);
+
+    /* A bad record is skipped, and a cut short one ends the archive */
+    data = chess_buffer_writer_data(&writer);
+    size = chess_buffer_writer_size(&writer);
+    data[first - 1] = 0x7f;
+    chess_buffer_reader_init_size(&reader, data, size - 1);
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_CORRUPT, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_CORRUPT, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_EOF, chess_archive_loader_next(&loader, game));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    /* So is one with a move that isn't legal, here from an empty square */
+    chess_buffer_writer_clear(&writer);
+    chess_archive_save_header((ChessWriter*)&writer);
+    chess_game_reset(game);
+    chess_game_append_move(game, MV(E3,E4));
+    chess_archive_save(game, (ChessWriter*)&writer);
+    chess_buffer_reader_init_size(&reader, chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&writer));
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_CORRUPT, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_EOF, chess_archive_loader_next(&loader, game));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    /* Unless the archive is trusted */
+    chess_buffer_reader_init_size(&reader, chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&writer));
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    chess_archive_loader_set_trusted(&loader, CHESS_TRUE);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_EQUAL(MV(E3,E4), chess_game_move_at_ply(game, 0));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_buffer_writer_cleanup(&writer);
+    chess_game_destroy(game);
+}
+
+static void test_archive_convert_pgn(void)
+{
+    const char pgn[] =
+        "[Event \"A\"]\n\n1. e4 e5 *\n\n"
+        "[Event \"B\"]\n\n1. e4 e4 *\n\n"
+        "[Event \"C\"]\n\n1. d4 (1. c4) d5 *\n";
+    ChessBufferReader reader;
+    ChessBufferWriter writer;
+    ChessArchiveLoader loader;
+    ChessGame* game = chess_game_new();
+    size_t written, skipped;
+
+    chess_buffer_reader_init(&reader, pgn);
+    chess_buffer_writer_init(&writer);
+    written = chess_archive_convert_pgn((ChessReader*)&reader, (ChessWriter*)&writer, &skipped);
+    CU_ASSERT_EQUAL(2, written);
+    CU_ASSERT_EQUAL(1, skipped);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_buffer_reader_init_size(&reader, chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&writer));
+    chess_archive_loader_init(&loader, (ChessReader*)&reader);
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_STRING_EQUAL("A", chess_game_event(game));
+    CU_ASSERT_EQUAL(2, chess_game_ply(game));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_OK, chess_archive_loader_next(&loader, game));
+    CU_ASSERT_STRING_EQUAL("C", chess_game_event(game));
+    CU_ASSERT_EQUAL(2, chess_variation_num_children(chess_game_root_variation(game)));
+    CU_ASSERT_EQUAL(CHESS_ARCHIVE_LOAD_EOF, chess_archive_loader_next(&loader, game));
+    chess_archive_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+
+    chess_buffer_writer_cleanup(&writer);
+    chess_game_destroy(game);
+}
+
+void test_archive_add_tests(void)
+{
+    CU_Suite* suite = add_suite("archive");
+    CU_add_test(suite, "archive_save_load", (CU_TestFunc)test_archive_save_load);
+    CU_add_test(suite, "archive_corrupt", (CU_TestFunc)test_archive_corrupt);
+    CU_add_test(suite, "archive_convert_pgn", (CU_TestFunc)test_archive_convert_pgn);
+}
@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+
+#include "../carena.h"
+
+#include "helpers.h"
+
+static void test_carena_alloc(void)
+{
+    ChessArena arena;
+    char* a, *b;
+    double* d;
+
+    chess_arena_init(&arena);
+
+    a = chess_arena_alloc(&arena, 3);
+    b = chess_arena_alloc(&arena, 5);
+    CU_ASSERT(a != NULL && b != NULL);
+    CU_ASSERT(b >= a + 3);
+    memcpy(a, "ab", 3);
+    memcpy(b, "cdef", 5);
+    CU_ASSERT_STRING_EQUAL("ab", a);
+    CU_ASSERT_STRING_EQUAL("cdef", b);
+
+    /* Still aligned after an odd size */
+    d = chess_arena_alloc(&arena, sizeof(double));
+    CU_ASSERT_EQUAL(0, (size_t)d % sizeof(double));
+    *d = 1.5;
+    CU_ASSERT_STRING_EQUAL("cdef", b);
+
+    chess_arena_cleanup(&arena);
+}
+
+static void test_carena_large(void)
+{
+    ChessArena arena;
+    char* small, *large;
+    int i;
+
+    chess_arena_init(&arena);
+
+    small = chess_arena_alloc(&arena, 16);
+    large = chess_arena_alloc(&arena, 100000);
+    memset(large, 'x', 100000);
+    memset(small, 'y', 16);
+    CU_ASSERT_EQUAL('x', large[0]);
+    CU_ASSERT_EQUAL('x', large[99999]);
+
+    /* Lots of blocks' worth */
+    for (i = 0; i < 10000; i++)
+        memset(chess_arena_alloc(&arena, 24), 0, 24);
+    CU_ASSERT_EQUAL('y', small[15]);
+
+    chess_arena_cleanup(&arena);
+}
+
+static void test_carena_reset(void)
+{
+    ChessArena arena;
+    char* first, *p;
+    int i;
+
+    chess_arena_init(&arena);
+    chess_arena_reset(&arena);
+
+    first = chess_arena_alloc(&arena, 32);
+    for (i = 0; i < 1000; i++)
+        chess_arena_alloc(&arena, 100);
+
+    /* Memory is handed out again from the start */
+    chess_arena_reset(&arena);
+    p = chess_arena_alloc(&arena, 32);
+    CU_ASSERT_EQUAL(first, p);
+    for (i = 0; i < 1000; i++)
+        memset(chess_arena_alloc(&arena, 100), 0, 100);
+
+    chess_arena_cleanup(&arena);
+}
+
+void test_carena_add_tests(void)
+{
+    CU_Suite* suite = add_suite("carena");
+    CU_add_test(suite, "alloc", (CU_TestFunc)test_carena_alloc);
+    CU_add_test(suite, "large", (CU_TestFunc)test_carena_large);
+    CU_add_test(suite, "reset", (CU_TestFunc)test_carena_reset);
+}
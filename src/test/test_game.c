@@ -56,6 +56,86 @@ static void test_game_move(void)
     chess_game_destroy(game);
 }
 
+static void test_game_compact(void)
+{
+    ChessGame* game;
+    ChessVariation* root;
+    ChessGameIterator iter;
+
+    game = chess_game_new();
+    CU_ASSERT(chess_game_is_compact(game));
+    chess_game_append_move(game, MV(E2,E4));
+    chess_game_append_move(game, MV(E7,E5));
+    chess_game_append_move(game, MVP(G1,F3,NONE));
+    CU_ASSERT(chess_game_is_compact(game));
+    CU_ASSERT_EQUAL(3, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(E7,E5), chess_game_move_at_ply(game, 1));
+    CU_ASSERT_EQUAL(MV(G1,F3), chess_game_move_at_ply(game, 2));
+    /* Reading the tree doesn't build it */
+    CU_ASSERT(chess_game_tree(game)->first_child == NULL);
+    CU_ASSERT(chess_game_is_compact(game));
+
+    /* Asking for the tree builds it */
+    root = chess_game_root_variation(game);
+    CU_ASSERT(!chess_game_is_compact(game));
+    CU_ASSERT_EQUAL(3, chess_variation_length(root));
+    CU_ASSERT_EQUAL(MV(E2,E4), root->first_child->move);
+    chess_game_append_move(game, MV(B8,C6));
+    CU_ASSERT_EQUAL(4, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(B8,C6), chess_game_move_at_ply(game, 3));
+
+    chess_game_reset(game);
+    CU_ASSERT(chess_game_is_compact(game));
+    CU_ASSERT_EQUAL(0, chess_game_ply(game));
+
+    /* So does an iterator */
+    chess_game_append_move(game, MV(D2,D4));
+    chess_game_iterator_init(&iter, game);
+    CU_ASSERT(!chess_game_is_compact(game));
+    chess_game_iterator_step_to_end(&iter);
+    CU_ASSERT_EQUAL(MV(D2,D4), chess_game_iterator_move(&iter));
+    chess_game_iterator_cleanup(&iter);
+
+    chess_game_destroy(game);
+}
+
+static void test_game_ply(void)
+{
+    ChessGame* game;
+    ChessVariation* root, *e4, *d4;
+
+    game = chess_game_new();
+    root = chess_game_root_variation(game);
+    e4 = chess_variation_add_child(root, MV(E2,E4));
+    chess_variation_add_child(chess_variation_add_child(e4, MV(E7,E5)), MV(G1,F3));
+    CU_ASSERT_EQUAL(3, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(G1,F3), chess_game_move_at_ply(game, 2));
+
+    /* Changes to the tree show up in the mainline */
+    d4 = chess_variation_add_child(root, MV(D2,D4));
+    chess_variation_add_child(d4, MV(D7,D5));
+    CU_ASSERT_EQUAL(3, chess_game_ply(game));
+    chess_variation_promote(d4);
+    CU_ASSERT_EQUAL(2, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(D2,D4), chess_game_move_at_ply(game, 0));
+    CU_ASSERT_EQUAL(MV(D7,D5), chess_game_move_at_ply(game, 1));
+
+    chess_variation_truncate(d4);
+    CU_ASSERT_EQUAL(1, chess_game_ply(game));
+    chess_variation_delete(d4);
+    CU_ASSERT_EQUAL(3, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(E2,E4), chess_game_move_at_ply(game, 0));
+    chess_game_expand(game);
+    CU_ASSERT_EQUAL(3, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(G1,F3), chess_game_move_at_ply(game, 2));
+
+    chess_game_append_move(game, MV(B8,C6));
+    CU_ASSERT_EQUAL(4, chess_game_ply(game));
+    CU_ASSERT_EQUAL(MV(B8,C6), chess_game_move_at_ply(game, 3));
+
+    chess_game_destroy(game);
+}
+
 static void test_game_result(void)
 {
     ChessGame* game;
@@ -494,11 +574,75 @@ static void test_game_step_to_move(void)
     chess_game_destroy(game);
 }
 
+static void test_game_repetitions(void)
+{
+    ChessGame* game;
+    ChessGameIterator iter;
+    int i;
+
+    game = chess_game_new();
+    chess_game_iterator_init(&iter, game);
+    CU_ASSERT_EQUAL(1, chess_game_iterator_repetitions(&iter));
+
+    /* Knights out and back twice brings the start position round again */
+    for (i = 0; i < 2; i++)
+    {
+        chess_game_iterator_append_move(&iter, MV(G1,F3));
+        chess_game_iterator_append_move(&iter, MV(G8,F6));
+        CU_ASSERT_EQUAL(i + 1, chess_game_iterator_repetitions(&iter));
+        chess_game_iterator_append_move(&iter, MV(F3,G1));
+        chess_game_iterator_append_move(&iter, MV(F6,G8));
+        CU_ASSERT_EQUAL(i + 2, chess_game_iterator_repetitions(&iter));
+    }
+    CU_ASSERT(chess_game_iterator_is_repetition_draw(&iter));
+
+    chess_game_iterator_step_back(&iter);
+    CU_ASSERT_EQUAL(2, chess_game_iterator_repetitions(&iter));
+    CU_ASSERT(!chess_game_iterator_is_repetition_draw(&iter));
+    chess_game_iterator_step_forward(&iter);
+    CU_ASSERT(chess_game_iterator_is_repetition_draw(&iter));
+
+    /* A pawn move means nothing before it can repeat */
+    chess_game_iterator_append_move(&iter, MV(E2,E4));
+    chess_game_iterator_append_move(&iter, MV(E7,E5));
+    CU_ASSERT_EQUAL(1, chess_game_iterator_repetitions(&iter));
+
+    chess_game_iterator_step_to_start(&iter);
+    CU_ASSERT_EQUAL(1, chess_game_iterator_repetitions(&iter));
+
+    chess_game_iterator_cleanup(&iter);
+    chess_game_destroy(game);
+}
+
+static void test_game_fifty_move_draw(void)
+{
+    ChessGame* game;
+    ChessGameIterator iter;
+
+    game = chess_game_new_fen("8/8/8/8/8/2k5/8/K6R w - - 99 80");
+    chess_game_iterator_init(&iter, game);
+    CU_ASSERT(!chess_game_iterator_is_fifty_move_draw(&iter));
+    chess_game_iterator_append_move(&iter, MV(H1,H2));
+    CU_ASSERT(chess_game_iterator_is_fifty_move_draw(&iter));
+    chess_game_iterator_cleanup(&iter);
+    chess_game_destroy(game);
+
+    /* Mate on the hundredth ply still stands */
+    game = chess_game_new_fen("k7/8/1K6/8/8/8/8/7R w - - 99 80");
+    chess_game_iterator_init(&iter, game);
+    chess_game_iterator_append_move(&iter, MV(H1,H8));
+    CU_ASSERT(!chess_game_iterator_is_fifty_move_draw(&iter));
+    chess_game_iterator_cleanup(&iter);
+    chess_game_destroy(game);
+}
+
 void test_game_add_tests(void)
 {
     CU_Suite* suite = add_suite("game");
     CU_add_test(suite, "game_new", (CU_TestFunc)test_game_new);
     CU_add_test(suite, "game_move", (CU_TestFunc)test_game_move);
+    CU_add_test(suite, "game_compact", (CU_TestFunc)test_game_compact);
+    CU_add_test(suite, "game_ply", (CU_TestFunc)test_game_ply);
     CU_add_test(suite, "game_result", (CU_TestFunc)test_game_result);
     CU_add_test(suite, "game_set_result", (CU_TestFunc)test_game_set_result);
     CU_add_test(suite, "game_tags", (CU_TestFunc)test_game_tags);
@@ -506,4 +650,6 @@ void test_game_add_tests(void)
     CU_add_test(suite, "game_tag_iterator", (CU_TestFunc)test_game_tag_iterator);
     CU_add_test(suite, "game_step_to_end", (CU_TestFunc)test_game_step_to_end);
     CU_add_test(suite, "game_step_to_move", (CU_TestFunc)test_game_step_to_move);
+    CU_add_test(suite, "game_repetitions", (CU_TestFunc)test_game_repetitions);
+    CU_add_test(suite, "game_fifty_move_draw", (CU_TestFunc)test_game_fifty_move_draw);
 }
@@ -20,14 +20,13 @@ static void test_generate_moves(void)
         MV(G1,F3), MV(G1,H3),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load(CHESS_FEN_STARTING_POSITION, &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
 }
 
 static void test_generate_moves2(void)
@@ -48,14 +47,13 @@ static void test_generate_moves2(void)
         MV(E1,D2), MV(E1,E2), MV(E1,F1), MV(E1,G1),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load("r3kbnr/ppp1qppp/2np4/4p3/2BPP1b1/2N2N2/PPP2PPP/R1BQK2R w KQkq - 0 6", &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
 }
 
 static void test_generate_moves3(void)
@@ -76,14 +74,13 @@ static void test_generate_moves3(void)
         MV(E8,D8), MV(E8,D7), MV(E8,C8),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load("r3kbnr/ppp1qppp/2np4/4p3/2BPP1b1/2N2N2/PPP2PPP/R1BQ1RK1 b kq - 0 6", &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
 }
 
 static void test_generate_moves4(void)
@@ -104,14 +101,13 @@ static void test_generate_moves4(void)
         MV(E1,D2), MV(E1,E2), MV(E1,F1), MV(E1,G1),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load("r1bqk1nr/pppp1ppp/2n5/2b5/2BpP3/5N2/PPP2PPP/RNBQK2R w KQkq - 0 5", &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
 }
 
 static void test_generate_moves5(void)
@@ -131,14 +127,13 @@ static void test_generate_moves5(void)
         MV(E8,D8), MV(E8,E7),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load("r1b1k2r/pppp1pBp/8/b2P4/2B4q/1Q6/P4PP1/R4RK1 b kq - 0 15", &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
 }
 
 static void test_generate_moves6(void)
@@ -159,14 +154,40 @@ static void test_generate_moves6(void)
         MVP(E2,F1,KNIGHT), MVP(E2,F1,BISHOP), MVP(E2,F1,ROOK), MVP(E2,F1,QUEEN),
     };
     ChessPosition position;
-    ChessArray moves;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
 
     chess_fen_load("r1bqrnk1/ppp1bNp1/7p/2P5/3P4/3Q1N2/PPB1p1PP/R4RK1 b - - 3 16", &position);
-    chess_array_init(&moves, sizeof(ChessMove));
-    chess_generate_moves(&position, &moves);
-    ASSERT_SETS_EQUAL((ChessMove*)chess_array_data(&moves), chess_array_size(&moves),
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
                       expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
-    chess_array_cleanup(&moves);
+}
+
+static void test_generate_pins(void)
+{
+    ChessMove expected_moves[] = {
+        MV(A5,A4), MV(A5,A6), MV(A5,B6),
+        MV(B5,B6),
+    };
+    ChessMove expected_moves2[] = {
+        MV(D1,C1), MV(D1,C2), MV(D1,D2), MV(D1,E1),
+        MV(D3,D2), MV(D3,D4), MV(D3,D5), MV(D3,D6), MV(D3,D7), MV(D3,D8),
+    };
+    ChessPosition position;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    size_t num_moves;
+
+    /* Taking en passant would expose the king along the rank */
+    chess_fen_load("8/8/8/KPp4r/8/8/8/4k3 w - c6 0 1", &position);
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
+                      expected_moves, sizeof(expected_moves) / sizeof(ChessMove));
+
+    /* The knight can not move at all, the rook only along the pin */
+    chess_fen_load("k2r4/8/8/7b/8/3R4/4N3/3K4 w - - 0 1", &position);
+    num_moves = chess_generate_moves(&position, moves);
+    ASSERT_SETS_EQUAL(moves, num_moves,
+                      expected_moves2, sizeof(expected_moves2) / sizeof(ChessMove));
 }
 
 static void test_move_generator(void)
@@ -182,6 +203,31 @@ static void test_move_generator(void)
     CU_ASSERT_EQUAL(218, count);
 }
 
+static void test_square_attacked(void)
+{
+    ChessPosition position;
+
+    chess_fen_load("4k3/8/2p5/8/Q3P1r1/8/1B6/4K3 w - - 0 1", &position);
+
+    /* Rook on g4 is blocked by the pawn on e4 */
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_F4, CHESS_COLOR_BLACK));
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_E4, CHESS_COLOR_BLACK));
+    CU_ASSERT(!chess_generate_is_square_attacked(&position, CHESS_SQUARE_D4, CHESS_COLOR_BLACK));
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_G1, CHESS_COLOR_BLACK));
+
+    /* Queen on a4 sees along the rank up to e4 and the diagonal up to c6 */
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_D4, CHESS_COLOR_WHITE));
+    CU_ASSERT(!chess_generate_is_square_attacked(&position, CHESS_SQUARE_F4, CHESS_COLOR_WHITE));
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_C6, CHESS_COLOR_WHITE));
+    CU_ASSERT(!chess_generate_is_square_attacked(&position, CHESS_SQUARE_D7, CHESS_COLOR_WHITE));
+
+    /* Bishop on b2 reaches h8, and the pawn on c6 covers b5 and d5 */
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_H8, CHESS_COLOR_WHITE));
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_B5, CHESS_COLOR_BLACK));
+    CU_ASSERT(chess_generate_is_square_attacked(&position, CHESS_SQUARE_D5, CHESS_COLOR_BLACK));
+    CU_ASSERT(!chess_generate_is_square_attacked(&position, CHESS_SQUARE_C5, CHESS_COLOR_BLACK));
+}
+
 void test_generate_add_tests(void)
 {
     CU_Suite* suite = add_suite("generate");
@@ -191,5 +237,7 @@ void test_generate_add_tests(void)
     CU_add_test(suite, "generate_moves4", (CU_TestFunc)test_generate_moves4);
     CU_add_test(suite, "generate_moves5", (CU_TestFunc)test_generate_moves5);
     CU_add_test(suite, "generate_moves6", (CU_TestFunc)test_generate_moves6);
+    CU_add_test(suite, "generate_pins", (CU_TestFunc)test_generate_pins);
     CU_add_test(suite, "move_generator", (CU_TestFunc)test_move_generator);
+    CU_add_test(suite, "square_attacked", (CU_TestFunc)test_square_attacked);
 }
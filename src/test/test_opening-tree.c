@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <CUnit/CUnit.h>
+
+#include "../fen.h"
+#include "../opening-tree.h"
+
+#include "helpers.h"
+
+static const char pgn[] =
+    "[WhiteElo \"2000\"]\n[BlackElo \"1800\"]\n[Result \"1-0\"]\n\n"
+    "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 1-0\n\n"
+    "[WhiteElo \"2200\"]\n[Result \"1/2-1/2\"]\n\n"
+    "1. e4 c5 2. Nf3 d6 3. d4 cxd4 4. Nxd4 Nf6 5. Nc3 a6 1/2-1/2\n\n"
+    "[BlackElo \"2400\"]\n[Result \"0-1\"]\n\n"
+    "1. d4 Nf6 2. c4 e6 3. Nc3 Bb4 0-1\n\n"
+    "[Result \"*\"]\n\n"
+    "1. e4 e5 2. Nf3 Nf6 *\n\n";
+
+static size_t build_tree(const char* filename, size_t max_memory, size_t max_ply)
+{
+    ChessOpeningTreeBuilder builder;
+    ChessBufferReader reader;
+    ChessPgnLoader loader;
+    size_t count;
+
+    chess_buffer_reader_init(&reader, pgn);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+    chess_opening_tree_builder_init(&builder, max_memory, max_ply);
+    count = chess_opening_tree_builder_add_pgn(&builder, &loader);
+    CU_ASSERT(chess_opening_tree_builder_save(&builder, filename));
+    chess_opening_tree_builder_cleanup(&builder);
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+    return count;
+}
+
+static size_t find_fen(const ChessOpeningTree* tree, const char* fen,
+    const ChessOpeningTreeMove** moves)
+{
+    ChessPosition position;
+    if (!chess_fen_load(fen, &position))
+        return 0;
+    return chess_opening_tree_find(tree, chess_position_hash(&position), moves);
+}
+
+static void check_tree(const char* filename, size_t num_moves)
+{
+    ChessOpeningTree tree;
+    const ChessOpeningTreeMove* moves;
+
+    CU_ASSERT(chess_opening_tree_init(&tree, filename));
+    CU_ASSERT_EQUAL(num_moves, tree.num_moves);
+
+    CU_ASSERT_EQUAL(2, find_fen(&tree, CHESS_FEN_STARTING_POSITION, &moves));
+    /* In order of ChessMove, so d2-d4 comes before e2-e4 */
+    CU_ASSERT_EQUAL(MV(D2,D4), moves[0].move);
+    CU_ASSERT_EQUAL(1, moves[0].games);
+    CU_ASSERT_EQUAL(1, moves[0].black_wins);
+    CU_ASSERT_EQUAL(0, moves[0].elo_games);
+    CU_ASSERT_EQUAL(0, chess_opening_tree_move_average_elo(&moves[0]));
+    CU_ASSERT_EQUAL(MV(E2,E4), moves[1].move);
+    CU_ASSERT_EQUAL(3, moves[1].games);
+    CU_ASSERT_EQUAL(1, moves[1].white_wins);
+    CU_ASSERT_EQUAL(1, moves[1].draws);
+    CU_ASSERT_EQUAL(0, moves[1].black_wins);
+    CU_ASSERT_EQUAL(2, moves[1].elo_games);
+    CU_ASSERT_EQUAL(2100, chess_opening_tree_move_average_elo(&moves[1]));
+
+    /* After 1. e4 e5 2. Nf3, black's Elo counts */
+    CU_ASSERT_EQUAL(2, find_fen(&tree,
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2", &moves));
+    CU_ASSERT_EQUAL(MV(B8,C6), moves[0].move);
+    CU_ASSERT_EQUAL(1800, chess_opening_tree_move_average_elo(&moves[0]));
+    CU_ASSERT_EQUAL(MV(G8,F6), moves[1].move);
+    CU_ASSERT_EQUAL(1, moves[1].games);
+    CU_ASSERT_EQUAL(0, moves[1].white_wins + moves[1].draws + moves[1].black_wins);
+
+    CU_ASSERT_EQUAL(0, find_fen(&tree,
+        "rnbqkbnr/pppppppp/8/8/8/7N/PPPPPPPP/RNBQKB1R b KQkq - 1 1", &moves));
+    chess_opening_tree_cleanup(&tree);
+}
+
+static void test_opening_tree(void)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+    ChessOpeningTree tree;
+
+    make_temp_file(filename, "");
+
+    /* 1. e4 is in three games and 1... e5 2. Nf3 in two */
+    CU_ASSERT_EQUAL(4, build_tree(filename, 1 << 20, 0));
+    check_tree(filename, 22);
+
+    /* Only the first two moves of each game */
+    CU_ASSERT_EQUAL(4, build_tree(filename, 1 << 20, 2));
+    CU_ASSERT(chess_opening_tree_init(&tree, filename));
+    CU_ASSERT_EQUAL(5, tree.num_moves);
+    chess_opening_tree_cleanup(&tree);
+
+    /* Anything else isn't a tree */
+    write_file(filename, "[Event \"?\"]");
+    CU_ASSERT(!chess_opening_tree_init(&tree, filename));
+
+    unlink(filename);
+}
+
+static void test_opening_tree_spill(void)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+
+    make_temp_file(filename, "");
+
+    /* With no memory to speak of, the moves go through temporary files and
+     * come out the same */
+    CU_ASSERT_EQUAL(4, build_tree(filename, 0, 0));
+    check_tree(filename, 22);
+
+    unlink(filename);
+}
+
+static void check_save_again(size_t max_memory)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+    ChessOpeningTreeBuilder builder;
+    ChessBufferReader reader;
+    ChessPgnLoader loader;
+    ChessOpeningTree tree;
+    const ChessOpeningTreeMove* moves;
+
+    make_temp_file(filename, "");
+    chess_buffer_reader_init(&reader, pgn);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+    chess_opening_tree_builder_init(&builder, max_memory, 0);
+
+    CU_ASSERT_EQUAL(4, chess_opening_tree_builder_add_pgn(&builder, &loader));
+    CU_ASSERT(chess_opening_tree_builder_save(&builder, filename));
+    check_tree(filename, 22);
+    CU_ASSERT(chess_opening_tree_builder_save(&builder, filename));
+    check_tree(filename, 22);
+
+    /* Then the games again, with their moves deferred */
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+    chess_buffer_reader_init(&reader, pgn);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+    chess_pgn_loader_set_defer_moves(&loader, CHESS_TRUE);
+    CU_ASSERT_EQUAL(4, chess_opening_tree_builder_add_pgn(&builder, &loader));
+    CU_ASSERT(chess_opening_tree_builder_save(&builder, filename));
+
+    CU_ASSERT(chess_opening_tree_init(&tree, filename));
+    CU_ASSERT_EQUAL(22, tree.num_moves);
+    CU_ASSERT_EQUAL(2, find_fen(&tree, CHESS_FEN_STARTING_POSITION, &moves));
+    CU_ASSERT_EQUAL(2, moves[0].games);
+    CU_ASSERT_EQUAL(6, moves[1].games);
+    CU_ASSERT_EQUAL(4, moves[1].elo_games);
+    CU_ASSERT_EQUAL(2100, chess_opening_tree_move_average_elo(&moves[1]));
+    chess_opening_tree_cleanup(&tree);
+
+    chess_opening_tree_builder_cleanup(&builder);
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+    unlink(filename);
+}
+
+static void test_opening_tree_save_again(void)
+{
+    /* Saving leaves the builder as it was, in memory or spilled */
+    check_save_again(1 << 20);
+    check_save_again(0);
+}
+
+void test_opening_tree_add_tests(void)
+{
+    CU_Suite* suite = add_suite("opening-tree");
+    CU_add_test(suite, "opening_tree", (CU_TestFunc)test_opening_tree);
+    CU_add_test(suite, "opening_tree_spill", (CU_TestFunc)test_opening_tree_spill);
+    CU_add_test(suite, "opening_tree_save_again", (CU_TestFunc)test_opening_tree_save_again);
+}
@@ -17,6 +17,7 @@ static void test_parse_move(void)
 
     /* Removing the pawn on f4 should actually lead to an ambiguous move */
     position.piece[CHESS_SQUARE_F4] = CHESS_PIECE_NONE;
+    chess_position_validate(&position);
     CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_AMBIGUOUS, chess_parse_move("f5", &position, &move));
 
     /* Another bug - castling queenside is failing */
@@ -35,6 +36,41 @@ static void test_parse_move(void)
     CU_ASSERT_EQUAL(MVP(D2,D1,ROOK), move);
 }
 
+static void test_parse_move_legality(void)
+{
+    ChessPosition position;
+    ChessMove move;
+
+    /* Only one of the knights that reach f3 isn't pinned */
+    chess_fen_load("4k3/8/8/8/1b6/8/3N4/4K1N1 w - - 0 1", &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_OK, chess_parse_move("Nf3", &position, &move));
+    CU_ASSERT_EQUAL(MV(G1,F3), move);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_ILLEGAL, chess_parse_move("Ndf3", &position, &move));
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_ILLEGAL, chess_parse_move("Ne4", &position, &move));
+
+    /* Castling through check */
+    chess_fen_load("4k3/8/8/8/8/8/5r2/4K2R w K - 0 1", &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_ILLEGAL, chess_parse_move("O-O", &position, &move));
+
+    /* En passant, unless it uncovers the king */
+    chess_fen_load("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 2", &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_OK, chess_parse_move("exd6", &position, &move));
+    CU_ASSERT_EQUAL(MV(E5,D6), move);
+    chess_fen_load("8/8/8/KPp4r/8/8/8/7k w - c6 0 1", &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_ILLEGAL, chess_parse_move("bxc6", &position, &move));
+
+    /* A promotion has to say what to */
+    chess_fen_load("4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_AMBIGUOUS, chess_parse_move("b8", &position, &move));
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_OK, chess_parse_move("b8=N", &position, &move));
+    CU_ASSERT_EQUAL(MVP(B7,B8,KNIGHT), move);
+
+    /* Without a whole destination square */
+    chess_fen_load(CHESS_FEN_STARTING_POSITION, &position);
+    CU_ASSERT_EQUAL(CHESS_PARSE_MOVE_OK, chess_parse_move("Nf", &position, &move));
+    CU_ASSERT_EQUAL(MV(G1,F3), move);
+}
+
 static void test_parse_null_move(void)
 {
     ChessPosition position;
@@ -53,5 +89,6 @@ void test_parse_add_tests(void)
 {
     CU_Suite* suite = add_suite("parse");
     CU_add_test(suite, "parse_move", (CU_TestFunc)test_parse_move);
+    CU_add_test(suite, "parse_move_legality", (CU_TestFunc)test_parse_move_legality);
     CU_add_test(suite, "parse_null_move", (CU_TestFunc)test_parse_null_move);
 }
@@ -0,0 +1,88 @@
+#include <CUnit/CUnit.h>
+
+#include "../fen.h"
+#include "../generate.h"
+#include "../perft.h"
+
+#include "helpers.h"
+
+static void test_perft_start(void)
+{
+    ChessPosition position, original;
+
+    chess_fen_load(CHESS_FEN_STARTING_POSITION, &position);
+    chess_position_copy(&position, &original);
+
+    CU_ASSERT_EQUAL(1, chess_perft(&position, 0));
+    CU_ASSERT_EQUAL(20, chess_perft(&position, 1));
+    CU_ASSERT_EQUAL(400, chess_perft(&position, 2));
+    CU_ASSERT_EQUAL(8902, chess_perft(&position, 3));
+    ASSERT_POSITIONS_EQUAL(&original, &position);
+}
+
+static void test_perft_positions(void)
+{
+    ChessPosition position;
+
+    /* Castling, promotions and en passant all show up early here */
+    chess_fen_load("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", &position);
+    CU_ASSERT_EQUAL(48, chess_perft(&position, 1));
+    CU_ASSERT_EQUAL(2039, chess_perft(&position, 2));
+
+    /* Discovered checks along the rank and en passant pins */
+    chess_fen_load("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", &position);
+    CU_ASSERT_EQUAL(2812, chess_perft(&position, 3));
+    CU_ASSERT_EQUAL(43238, chess_perft(&position, 4));
+
+    chess_fen_load("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", &position);
+    CU_ASSERT_EQUAL(9467, chess_perft(&position, 3));
+
+    chess_fen_load("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", &position);
+    CU_ASSERT_EQUAL(1486, chess_perft(&position, 2));
+}
+
+static void test_perft_divide(void)
+{
+    ChessPosition position, original;
+    ChessMove moves[CHESS_GENERATE_MAX_MOVES];
+    uint64_t nodes[CHESS_GENERATE_MAX_MOVES], total = 0;
+    size_t num_moves, i;
+
+    chess_fen_load("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", &position);
+    chess_position_copy(&position, &original);
+
+    num_moves = chess_perft_divide(&position, 3, moves, nodes);
+    CU_ASSERT_EQUAL(48, num_moves);
+    for (i = 0; i < num_moves; i++)
+    {
+        total += nodes[i];
+        if (moves[i] == MV(E1,G1))
+            CU_ASSERT_EQUAL(2059, nodes[i]);
+    }
+    CU_ASSERT_EQUAL(97862, total);
+    ASSERT_POSITIONS_EQUAL(&original, &position);
+}
+
+static void test_perft_parallel(void)
+{
+    ChessPosition position, original;
+
+    chess_fen_load("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", &position);
+    chess_position_copy(&position, &original);
+    CU_ASSERT_EQUAL(97862, chess_perft_parallel(&position, 3, 4));
+    CU_ASSERT_EQUAL(97862, chess_perft_parallel(&position, 3, 1));
+    ASSERT_POSITIONS_EQUAL(&original, &position);
+
+    /* Only six root moves, so the work is split further down */
+    chess_fen_load("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", &position);
+    CU_ASSERT_EQUAL(422333, chess_perft_parallel(&position, 4, 8));
+}
+
+void test_perft_add_tests(void)
+{
+    CU_Suite* suite = add_suite("perft");
+    CU_add_test(suite, "perft_start", (CU_TestFunc)test_perft_start);
+    CU_add_test(suite, "perft_positions", (CU_TestFunc)test_perft_positions);
+    CU_add_test(suite, "perft_divide", (CU_TestFunc)test_perft_divide);
+    CU_add_test(suite, "perft_parallel", (CU_TestFunc)test_perft_parallel);
+}
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+
+#include "../cbuffer.h"
+#include "../pgn-parallel.h"
+
+#include "helpers.h"
+
+#define NUM_GAMES 150
+
+typedef struct
+{
+    size_t count, stop_after;
+    size_t next_index;
+    int seen[NUM_GAMES];
+    ChessBoolean ok;
+} LoadState;
+
+static void make_archive(ChessBuffer* buffer)
+{
+    char tags[64];
+    int i;
+
+    chess_buffer_init(buffer);
+    for (i = 0; i < NUM_GAMES; i++)
+    {
+        sprintf(tags, "[Event \"Test\"]\n[Round \"%d\"]\n\n", i);
+        chess_buffer_append_string(buffer, tags);
+        /* A tag inside a comment doesn't start a game */
+        chess_buffer_append_string(buffer, "1. e4 {Not a tag:\n[Event \"x\"]} e5 2. Nf3 *\n\n");
+    }
+}
+
+static ChessBoolean check_game(void* data, size_t index, ChessPgnLoadResult result, ChessGame* game)
+{
+    LoadState* state = (LoadState*)data;
+
+    if (index >= NUM_GAMES || result != CHESS_PGN_LOAD_OK
+        || atoi(chess_game_round(game)) != (int)index || chess_game_ply(game) != 3)
+    {
+        state->ok = CHESS_FALSE;
+        return CHESS_FALSE;
+    }
+    state->seen[index]++;
+    return !(state->stop_after && ++state->count == state->stop_after);
+}
+
+static ChessBoolean check_ordered(void* data, size_t index, ChessPgnLoadResult result, ChessGame* game)
+{
+    LoadState* state = (LoadState*)data;
+
+    if (index != state->next_index)
+    {
+        state->ok = CHESS_FALSE;
+        return CHESS_FALSE;
+    }
+    state->next_index++;
+    return check_game(data, index, result, game);
+}
+
+static void init_state(LoadState* state, size_t stop_after)
+{
+    memset(state, 0, sizeof(LoadState));
+    state->stop_after = stop_after;
+    state->ok = CHESS_TRUE;
+}
+
+static void test_find_games(void)
+{
+    const char text[] =
+        "junk\n"
+        "[Event \"A\"]\n"
+        "[Site \"B\"]\n"
+        "\n"
+        "1. e4 { a comment\n"
+        "[Event \"not a game\"]\n"
+        "} *\n"
+        "[Event \"C\"]\n"
+        "  [Site \"D\"]\n"
+        "1. d4 *\n"
+        "\n"
+        "  [Event \"E\"]\n";
+    ChessArray starts;
+    const size_t* offsets;
+
+    chess_array_init(&starts, sizeof(size_t));
+    chess_pgn_find_games(text, strlen(text), &starts);
+    CU_ASSERT_EQUAL(3, chess_array_size(&starts));
+    if (chess_array_size(&starts) == 3)
+    {
+        offsets = chess_array_data(&starts);
+        CU_ASSERT_NSTRING_EQUAL("[Event \"A\"]", text + offsets[0], 11);
+        CU_ASSERT_NSTRING_EQUAL("[Event \"C\"]", text + offsets[1], 11);
+        CU_ASSERT_NSTRING_EQUAL("[Event \"E\"]", text + offsets[2], 11);
+    }
+    chess_array_cleanup(&starts);
+
+    chess_array_init(&starts, sizeof(size_t));
+    chess_pgn_find_games("", 0, &starts);
+    CU_ASSERT_EQUAL(0, chess_array_size(&starts));
+    chess_array_cleanup(&starts);
+}
+
+static void test_load_parallel(void)
+{
+    ChessBuffer buffer;
+    LoadState state;
+    size_t count;
+    int i;
+
+    make_archive(&buffer);
+
+    /* In order */
+    init_state(&state, 0);
+    count = chess_pgn_load_parallel(chess_buffer_data(&buffer), chess_buffer_size(&buffer),
+        4, CHESS_TRUE, check_ordered, &state);
+    CU_ASSERT_EQUAL(NUM_GAMES, count);
+    CU_ASSERT(state.ok);
+    CU_ASSERT_EQUAL(NUM_GAMES, state.next_index);
+
+    /* As they come, each one once */
+    init_state(&state, 0);
+    count = chess_pgn_load_parallel(chess_buffer_data(&buffer), chess_buffer_size(&buffer),
+        4, CHESS_FALSE, check_game, &state);
+    CU_ASSERT_EQUAL(NUM_GAMES, count);
+    CU_ASSERT(state.ok);
+    for (i = 0; i < NUM_GAMES; i++)
+        CU_ASSERT_EQUAL(1, state.seen[i]);
+
+    /* On one thread */
+    init_state(&state, 0);
+    count = chess_pgn_load_parallel(chess_buffer_data(&buffer), chess_buffer_size(&buffer),
+        1, CHESS_TRUE, check_ordered, &state);
+    CU_ASSERT_EQUAL(NUM_GAMES, count);
+    CU_ASSERT(state.ok);
+
+    chess_buffer_cleanup(&buffer);
+}
+
+static void test_load_parallel_stop(void)
+{
+    ChessBuffer buffer;
+    LoadState state;
+    size_t count;
+    int i;
+
+    make_archive(&buffer);
+
+    init_state(&state, 10);
+    count = chess_pgn_load_parallel(chess_buffer_data(&buffer), chess_buffer_size(&buffer),
+        4, CHESS_TRUE, check_game, &state);
+    CU_ASSERT_EQUAL(10, count);
+    CU_ASSERT(state.ok);
+    for (i = 0; i < 10; i++)
+        CU_ASSERT_EQUAL(1, state.seen[i]);
+
+    init_state(&state, 10);
+    count = chess_pgn_load_parallel(chess_buffer_data(&buffer), chess_buffer_size(&buffer),
+        4, CHESS_FALSE, check_game, &state);
+    CU_ASSERT_EQUAL(10, count);
+    CU_ASSERT(state.ok);
+
+    chess_buffer_cleanup(&buffer);
+}
+
+static ChessBoolean record_result(void* data, size_t index, ChessPgnLoadResult result, ChessGame* game)
+{
+    ChessPgnLoadResult* results = (ChessPgnLoadResult*)data;
+    results[index] = result;
+    return CHESS_TRUE;
+}
+
+static void test_load_parallel_mismatch(void)
+{
+    /* The scan takes the brace after a bad token to open a comment, and
+     * misses the third game's tags, which the loader finds after giving up
+     * on the second game */
+    const char pgn[] =
+        "[Event \"One\"]\n\n1. e4 *\n\n"
+        "[Event \"Two\"]\n\n1. d4 ; {\n*\n\n"
+        "[Event \"Three\"]\n\n1. c4 *\n";
+    ChessPgnLoadResult results[3];
+    size_t count;
+
+    results[2] = CHESS_PGN_LOAD_OK;
+    count = chess_pgn_load_parallel(pgn, sizeof(pgn) - 1, 2, CHESS_TRUE, record_result, results);
+    CU_ASSERT_EQUAL(2, count);
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, results[0]);
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_UNEXPECTED_TOKEN, results[1]);
+
+    count = chess_pgn_load_parallel(pgn, sizeof(pgn) - 1, 2, CHESS_FALSE, record_result, results);
+    CU_ASSERT_EQUAL(2, count);
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_UNEXPECTED_TOKEN, results[1]);
+}
+
+static void test_save_many(void)
+{
+    ChessGame* games[NUM_GAMES];
+    const ChessGame* shared[NUM_GAMES];
+    ChessBufferWriter expected, writer;
+    char round[16];
+    int i;
+
+    chess_buffer_writer_init(&expected);
+    for (i = 0; i < NUM_GAMES; i++)
+    {
+        games[i] = chess_game_new();
+        sprintf(round, "%d", i);
+        chess_game_set_round(games[i], round);
+        chess_game_append_move(games[i], MV(E2, E4));
+        if (i % 2)
+            chess_game_append_move(games[i], MV(E7, E5));
+        chess_pgn_save(games[i], (ChessWriter*)&expected);
+    }
+
+    chess_buffer_writer_init(&writer);
+    chess_pgn_save_many((const ChessGame* const*)games, NUM_GAMES, 4, (ChessWriter*)&writer);
+    CU_ASSERT_EQUAL(chess_buffer_writer_size(&expected), chess_buffer_writer_size(&writer));
+    CU_ASSERT_NSTRING_EQUAL(chess_buffer_writer_data(&expected), chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&expected));
+
+    chess_buffer_writer_clear(&writer);
+    chess_pgn_save_many((const ChessGame* const*)games, NUM_GAMES, 1, (ChessWriter*)&writer);
+    CU_ASSERT_EQUAL(chess_buffer_writer_size(&expected), chess_buffer_writer_size(&writer));
+
+    chess_buffer_writer_clear(&writer);
+    chess_pgn_save_many((const ChessGame* const*)games, 0, 4, (ChessWriter*)&writer);
+    CU_ASSERT_EQUAL(0, chess_buffer_writer_size(&writer));
+
+    /* The same game over and over, with a tree changed since it was made */
+    chess_variation_add_child(chess_game_root_variation(games[0]), MV(D2,D4));
+    chess_variation_promote(chess_game_root_variation(games[0])->first_child->right);
+    chess_buffer_writer_clear(&expected);
+    for (i = 0; i < NUM_GAMES; i++)
+    {
+        chess_pgn_save(games[0], (ChessWriter*)&expected);
+        shared[i] = games[0];
+    }
+    chess_buffer_writer_clear(&writer);
+    chess_pgn_save_many(shared, NUM_GAMES, 4, (ChessWriter*)&writer);
+    CU_ASSERT_EQUAL(chess_buffer_writer_size(&expected), chess_buffer_writer_size(&writer));
+    CU_ASSERT_NSTRING_EQUAL(chess_buffer_writer_data(&expected), chess_buffer_writer_data(&writer),
+        chess_buffer_writer_size(&expected));
+
+    chess_buffer_writer_cleanup(&writer);
+    chess_buffer_writer_cleanup(&expected);
+    for (i = 0; i < NUM_GAMES; i++)
+        chess_game_destroy(games[i]);
+}
+
+void test_pgn_parallel_add_tests(void)
+{
+    CU_Suite* suite = add_suite("pgn-parallel");
+    CU_add_test(suite, "find_games", (CU_TestFunc)test_find_games);
+    CU_add_test(suite, "load_parallel", (CU_TestFunc)test_load_parallel);
+    CU_add_test(suite, "load_parallel_stop", (CU_TestFunc)test_load_parallel_stop);
+    CU_add_test(suite, "load_parallel_mismatch", (CU_TestFunc)test_load_parallel_mismatch);
+    CU_add_test(suite, "save_many", (CU_TestFunc)test_save_many);
+}
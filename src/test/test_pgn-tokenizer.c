@@ -1,3 +1,5 @@
+#include <stdio.h>
+
 #include <CUnit/CUnit.h>
 
 #include "../pgn-tokenizer.h"
@@ -294,6 +296,165 @@ static void test_error(void)
     chess_buffer_reader_cleanup(&reader);
 }
 
+static void test_views(void)
+{
+    const char text[] = "[Event \"A \\\"B\\\"\"] 1. e4 $1 {Good} 1-0";
+    ChessBufferReader reader;
+    ChessPgnTokenizer tokenizer;
+    const ChessPgnToken* token;
+    const char* start, *end, *event;
+
+    chess_buffer_reader_init(&reader, text);
+    chess_pgn_tokenizer_init(&tokenizer, (ChessReader*)&reader);
+    chess_pgn_tokenizer_set_views(&tokenizer, CHESS_TRUE);
+    start = reader.buffer;
+    end = start + reader.buffer_size;
+
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_L_BRACKET, 1, 1);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_SYMBOL, 1, 2);
+    CU_ASSERT(token->data >= start && token->data < end);
+    CU_ASSERT_EQUAL(5, token->size);
+    CU_ASSERT_NSTRING_EQUAL("Event", token->data, 5);
+    event = token->data;
+
+    /* Escaped strings are copied */
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_STRING, 1, 8);
+    CU_ASSERT(token->data < start || token->data >= end);
+    CU_ASSERT_EQUAL(5, token->size);
+    CU_ASSERT_STRING_EQUAL("A \"B\"", token->data);
+
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_R_BRACKET, 1, 17);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_NUMBER, 1, 19);
+    CU_ASSERT_EQUAL(1, token->number);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_SYMBOL, 1, 22);
+    CU_ASSERT(token->data >= start && token->data < end);
+    CU_ASSERT_EQUAL(2, token->size);
+    CU_ASSERT_NSTRING_EQUAL("e4", token->data, 2);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_NAG, 1, 25);
+    CU_ASSERT_EQUAL(1, token->number);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_COMMENT, 1, 28);
+    CU_ASSERT(token->data >= start && token->data < end);
+    CU_ASSERT_EQUAL(4, token->size);
+    CU_ASSERT_NSTRING_EQUAL("Good", token->data, 4);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_ONE_ZERO, 1, 35);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_EOF, 1, 38);
+
+    /* Views outlive the tokens */
+    CU_ASSERT_NSTRING_EQUAL("Event", event, 5);
+
+    chess_pgn_tokenizer_cleanup(&tokenizer);
+    chess_buffer_reader_cleanup(&reader);
+}
+
+static void test_long_runs(void)
+{
+    const char text[] = "e4                    \n\n   "
+        "{A comment that is long enough\nto span two lines, and more}  "
+        "\"A string with an \\\"escape\\\" well past sixteen bytes\"\t\t\n"
+        "                 e5";
+    ChessBufferReader reader;
+    ChessPgnTokenizer tokenizer;
+    const ChessPgnToken* token;
+    int views;
+
+    for (views = 0; views < 2; views++)
+    {
+        chess_buffer_reader_init(&reader, text);
+        chess_pgn_tokenizer_init(&tokenizer, (ChessReader*)&reader);
+        chess_pgn_tokenizer_set_views(&tokenizer, views);
+
+        token = chess_pgn_tokenizer_next(&tokenizer);
+        ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_SYMBOL, 1, 1);
+        token = chess_pgn_tokenizer_next(&tokenizer);
+        ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_COMMENT, 3, 4);
+        CU_ASSERT_EQUAL(57, token->size);
+        CU_ASSERT_NSTRING_EQUAL("A comment that is long enough\nto span two lines, and more",
+            token->data, 57);
+        token = chess_pgn_tokenizer_next(&tokenizer);
+        ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_STRING, 4, 31);
+        CU_ASSERT_STRING_EQUAL("A string with an \"escape\" well past sixteen bytes", token->data);
+        token = chess_pgn_tokenizer_next(&tokenizer);
+        ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_SYMBOL, 5, 18);
+        CU_ASSERT_NSTRING_EQUAL("e5", token->data, 2);
+        token = chess_pgn_tokenizer_next(&tokenizer);
+        ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_EOF, 5, 20);
+
+        chess_pgn_tokenizer_cleanup(&tokenizer);
+        chess_buffer_reader_cleanup(&reader);
+    }
+}
+
+static void test_skip_movetext(void)
+{
+    const char text[] = "1. e4 {[no]\n} (1. d4 [no]) 1-0\n\n[Event";
+    ChessBufferReader reader;
+    ChessPgnTokenizer tokenizer;
+    const ChessPgnToken* token;
+
+    chess_buffer_reader_init(&reader, text);
+    chess_pgn_tokenizer_init(&tokenizer, (ChessReader*)&reader);
+
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_NUMBER, 1, 1);
+    chess_pgn_tokenizer_skip_movetext(&tokenizer, 0);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_L_BRACKET, 4, 1);
+    token = chess_pgn_tokenizer_next(&tokenizer);
+    ASSERT_TOKEN_EQUAL(token, CHESS_PGN_TOKEN_SYMBOL, 4, 2);
+
+    chess_pgn_tokenizer_cleanup(&tokenizer);
+    chess_buffer_reader_cleanup(&reader);
+}
+
+/* Reads a file ending in the middle of a symbol or number, with no newline */
+static void check_file_end(const char* text, const ChessPgnTokenType* types, int num_tokens)
+{
+    ChessFileReader reader;
+    ChessPgnTokenizer tokenizer;
+    FILE* file;
+    int i;
+
+    file = tmpfile();
+    CU_ASSERT(file != NULL);
+    if (file == NULL)
+        return;
+    fputs(text, file);
+    rewind(file);
+
+    chess_file_reader_init(&reader, file);
+    chess_pgn_tokenizer_init(&tokenizer, (ChessReader*)&reader);
+    for (i = 0; i < num_tokens; i++)
+        CU_ASSERT_EQUAL(types[i], chess_pgn_tokenizer_next(&tokenizer)->type);
+    CU_ASSERT_EQUAL(CHESS_PGN_TOKEN_EOF, chess_pgn_tokenizer_next(&tokenizer)->type);
+    chess_pgn_tokenizer_cleanup(&tokenizer);
+    chess_file_reader_cleanup(&reader);
+    fclose(file);
+}
+
+static void test_file_end(void)
+{
+    const ChessPgnTokenType move[] = {
+        CHESS_PGN_TOKEN_NUMBER, CHESS_PGN_TOKEN_PERIOD, CHESS_PGN_TOKEN_SYMBOL
+    };
+    const ChessPgnTokenType result[] = {
+        CHESS_PGN_TOKEN_SYMBOL, CHESS_PGN_TOKEN_ONE_ZERO
+    };
+
+    check_file_end("1. e4", move, 3);
+    check_file_end("e4 1-0", result, 2);
+}
+
 void test_pgn_tokenizer_add_tests(void)
 {
     CU_Suite* suite = add_suite("pgn-tokenizer");
@@ -305,4 +466,8 @@ void test_pgn_tokenizer_add_tests(void)
     CU_add_test(suite, "nag", (CU_TestFunc)test_nag);
     CU_add_test(suite, "comment", (CU_TestFunc)test_comment);
     CU_add_test(suite, "error", (CU_TestFunc)test_error);
+    CU_add_test(suite, "views", (CU_TestFunc)test_views);
+    CU_add_test(suite, "long_runs", (CU_TestFunc)test_long_runs);
+    CU_add_test(suite, "skip_movetext", (CU_TestFunc)test_skip_movetext);
+    CU_add_test(suite, "file_end", (CU_TestFunc)test_file_end);
 }
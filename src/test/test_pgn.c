@@ -120,6 +120,7 @@ static void test_pgn_load(void)
     CU_ASSERT_EQUAL(CHESS_RESULT_WHITE_WINS, chess_game_result(game));
     CU_ASSERT_STRING_EQUAL("37", chess_game_tag_value(game, "PlyCount"));
     CU_ASSERT_EQUAL(37, chess_game_ply(game));
+    CU_ASSERT(chess_game_is_compact(game));
 
     chess_game_destroy(game);
 }
@@ -144,6 +145,7 @@ static void test_pgn_load_subvariations(void)
     result = chess_pgn_load((ChessReader*)&reader, game);
     CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, result);
     chess_buffer_reader_cleanup(&reader);
+    CU_ASSERT(!chess_game_is_compact(game));
 
     variation = chess_game_root_variation(game);
     variation = variation->first_child;
@@ -269,6 +271,113 @@ void test_pgn_load_setup(void)
 }
 
 
+static void test_pgn_loader_tags(void)
+{
+    const char pgn[] =
+        "[Event \"One\"]\n"
+        "[Result \"1-0\"]\n"
+        "\n"
+        "1. e4 {[%clk 0:03:00] not a tag} e5 (1... c5 [not a tag either]) 2. Qh5 1-0\n"
+        "\n"
+        "[Event \"Two\"]\n"
+        "[Result \"1/2-1/2\"]\n"
+        "\n"
+        "1. Zz9 ((1. d4)) 1/2-1/2\n"
+        "\n"
+        "[Event \"Three\"]\n"
+        "[White \"Tal, Mikhail\"]\n"
+        "[Result \"*\"]\n"
+        "\n"
+        "*\n";
+    ChessBufferReader reader;
+    ChessPgnLoader loader;
+    ChessGame* game = chess_game_new();
+
+    chess_buffer_reader_init(&reader, pgn);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next_tags(&loader, game));
+    CU_ASSERT_STRING_EQUAL("One", chess_game_event(game));
+    CU_ASSERT_EQUAL(CHESS_RESULT_WHITE_WINS, chess_game_result(game));
+    CU_ASSERT_EQUAL(0, chess_game_ply(game));
+
+    /* The moves aren't read, so illegal ones don't matter */
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next_tags(&loader, game));
+    CU_ASSERT_STRING_EQUAL("Two", chess_game_event(game));
+    CU_ASSERT_EQUAL(CHESS_RESULT_DRAW, chess_game_result(game));
+
+    /* Mixed with full games */
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game));
+    CU_ASSERT_STRING_EQUAL("Three", chess_game_event(game));
+    CU_ASSERT_STRING_EQUAL("Tal, Mikhail", chess_game_white(game));
+    CU_ASSERT_EQUAL(CHESS_RESULT_IN_PROGRESS, chess_game_result(game));
+
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_EOF, chess_pgn_loader_next_tags(&loader, game));
+
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+    chess_game_destroy(game);
+}
+
+static void test_pgn_loader_defer_moves(void)
+{
+    const char pgn[] =
+        "[Event \"One\"]\n"
+        "\n"
+        "1. e4 {Best by test} e5 (1... c5 2. Nf3) 2. Nf3 1-0\n"
+        "\n"
+        "[Event \"Two\"]\n"
+        "\n"
+        "1. d4 Ke3 0-1\n"
+        "\n"
+        "[Event \"Three\"]\n"
+        "\n"
+        "1. c4 *";
+    ChessBufferReader reader;
+    ChessPgnLoader loader;
+    ChessGame* game1 = chess_game_new();
+    ChessGame* game2 = chess_game_new();
+    ChessGameIterator iter;
+
+    chess_buffer_reader_init(&reader, pgn);
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+    chess_pgn_loader_set_defer_moves(&loader, CHESS_TRUE);
+
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game1));
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game2));
+    CU_ASSERT_STRING_EQUAL("One", chess_game_event(game1));
+    CU_ASSERT_STRING_EQUAL("Two", chess_game_event(game2));
+
+    /* Moves are read on first use, here by the iterator */
+    chess_game_iterator_init(&iter, game1);
+    chess_game_iterator_step_to_end(&iter);
+    CU_ASSERT_EQUAL(3, chess_game_iterator_ply(&iter));
+    chess_game_iterator_cleanup(&iter);
+    CU_ASSERT_EQUAL(MV(E2,E4), chess_game_move_at_ply(game1, 0));
+    CU_ASSERT_EQUAL(MV(G1,F3), chess_game_move_at_ply(game1, 2));
+    CU_ASSERT(chess_game_root_variation(game1)->first_child->first_child->right != NULL);
+    CU_ASSERT_EQUAL(CHESS_RESULT_WHITE_WINS, chess_game_result(game1));
+    CU_ASSERT(chess_game_load_moves(game1));
+
+    /* Errors turn up when the moves are read */
+    CU_ASSERT_FALSE(chess_game_load_moves(game2));
+    CU_ASSERT_EQUAL(1, chess_game_ply(game2));
+
+    /* The last game runs to the end of the input */
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game2));
+    CU_ASSERT_STRING_EQUAL("Three", chess_game_event(game2));
+    /* The const accessors don't load the moves */
+    CU_ASSERT_EQUAL(0, chess_game_ply(game2));
+    CU_ASSERT(chess_game_load_moves(game2));
+    CU_ASSERT_EQUAL(1, chess_game_ply(game2));
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_EOF, chess_pgn_loader_next(&loader, game2));
+
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+    chess_game_destroy(game1);
+    chess_game_destroy(game2);
+}
+
 void test_pgn_add_tests(void)
 {
     CU_Suite* suite = add_suite("pgn");
@@ -277,4 +386,6 @@ void test_pgn_add_tests(void)
     CU_add_test(suite, "pgn_load_subvariations", (CU_TestFunc)test_pgn_load_subvariations);
     CU_add_test(suite, "pgn_load_nags", (CU_TestFunc)test_pgn_load_nags);
     CU_add_test(suite, "pgn_load_setup", (CU_TestFunc)test_pgn_load_setup);
+    CU_add_test(suite, "pgn_loader_tags", (CU_TestFunc)test_pgn_loader_tags);
+    CU_add_test(suite, "pgn_loader_defer_moves", (CU_TestFunc)test_pgn_loader_defer_moves);
 }
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <CUnit/CUnit.h>
+
+#include "../fen.h"
+#include "../pgn.h"
+#include "../position-index.h"
+
+#include "helpers.h"
+
+static void add_moves(ChessGame* game, const ChessMove* moves, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        chess_game_append_move(game, moves[i]);
+}
+
+static const char four_knights[] =
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R w KQkq - 4 4";
+
+static void build_index(const char* filename, size_t max_memory)
+{
+    /* Two ways to the same Four Knights position, and a game that leaves it */
+    const ChessMove game0[] = { MV(E2,E4), MV(E7,E5), MV(G1,F3), MV(B8,C6), MV(B1,C3), MV(G8,F6) };
+    const ChessMove game1[] = { MV(G1,F3), MV(G8,F6), MV(B1,C3), MV(B8,C6), MV(E2,E4), MV(E7,E5) };
+    const ChessMove game2[] = { MV(E2,E4), MV(E7,E5), MV(G1,F3), MV(B8,C6), MV(F1,B5) };
+    ChessPositionIndexBuilder builder;
+    ChessGame* game;
+
+    game = chess_game_new();
+    chess_position_index_builder_init(&builder, max_memory);
+    add_moves(game, game0, 6);
+    CU_ASSERT(chess_position_index_builder_add_game(&builder, game, 0));
+    chess_game_reset(game);
+    add_moves(game, game1, 6);
+    CU_ASSERT(chess_position_index_builder_add_game(&builder, game, 1));
+    chess_game_reset(game);
+    add_moves(game, game2, 5);
+    CU_ASSERT(chess_position_index_builder_add_game(&builder, game, 2));
+
+    CU_ASSERT(chess_position_index_builder_save(&builder, filename));
+    chess_position_index_builder_cleanup(&builder);
+    chess_game_destroy(game);
+}
+
+static void check_index(const char* filename)
+{
+    ChessPositionIndex index;
+    const ChessPositionIndexEntry* entries;
+
+    CU_ASSERT(chess_position_index_init(&index, filename));
+    CU_ASSERT_EQUAL(7 + 7 + 6, index.num_entries);
+
+    CU_ASSERT_EQUAL(2, chess_position_index_find_fen(&index, four_knights, &entries));
+    CU_ASSERT_EQUAL(0, entries[0].game);
+    CU_ASSERT_EQUAL(6, entries[0].ply);
+    CU_ASSERT_EQUAL(1, entries[1].game);
+    CU_ASSERT_EQUAL(6, entries[1].ply);
+
+    /* Every game starts from here */
+    CU_ASSERT_EQUAL(3, chess_position_index_find_fen(&index, CHESS_FEN_STARTING_POSITION, &entries));
+    CU_ASSERT_EQUAL(2, entries[2].game);
+    CU_ASSERT_EQUAL(0, entries[2].ply);
+
+    /* 1. e4 e5 2. Nf3 Nc6 only happened twice */
+    CU_ASSERT_EQUAL(2, chess_position_index_find_fen(&index,
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3", &entries));
+    CU_ASSERT_EQUAL(0, chess_position_index_find_fen(&index,
+        "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq - 0 1", &entries));
+    CU_ASSERT_EQUAL(0, chess_position_index_find_fen(&index, "not a fen", &entries));
+    chess_position_index_cleanup(&index);
+}
+
+static void test_position_index(void)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+    ChessPositionIndex index;
+
+    make_temp_file(filename, "");
+    build_index(filename, 1 << 20);
+    check_index(filename);
+
+    /* Anything else isn't an index */
+    write_file(filename, "[Event \"?\"]");
+    CU_ASSERT(!chess_position_index_init(&index, filename));
+
+    unlink(filename);
+}
+
+static void test_position_index_spill(void)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+
+    make_temp_file(filename, "");
+
+    /* With no memory to speak of, each game goes through a temporary file
+     * and the index comes out the same */
+    build_index(filename, 0);
+    check_index(filename);
+
+    unlink(filename);
+}
+
+static void test_position_index_defer_moves(void)
+{
+    char filename[TEMP_FILE_NAME_SIZE];
+    ChessPositionIndexBuilder builder;
+    ChessBufferReader reader;
+    ChessPgnLoader loader;
+    ChessPositionIndex index;
+    const ChessPositionIndexEntry* entries;
+    ChessGame* game;
+
+    chess_buffer_reader_init(&reader,
+        "[Event \"One\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Nc3 Nf6 *\n\n"
+        "[Event \"Two\"]\n\n1. d4 Ke3 *\n");
+    chess_pgn_loader_init(&loader, (ChessReader*)&reader);
+    chess_pgn_loader_set_defer_moves(&loader, CHESS_TRUE);
+    chess_position_index_builder_init(&builder, 1 << 20);
+    game = chess_game_new();
+
+    /* The moves are loaded before the game is indexed, and a game whose
+     * moves don't all load is left out */
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game));
+    CU_ASSERT(chess_position_index_builder_add_game(&builder, game, 0));
+    CU_ASSERT_EQUAL(CHESS_PGN_LOAD_OK, chess_pgn_loader_next(&loader, game));
+    CU_ASSERT(!chess_position_index_builder_add_game(&builder, game, 1));
+
+    make_temp_file(filename, "");
+    CU_ASSERT(chess_position_index_builder_save(&builder, filename));
+    CU_ASSERT(chess_position_index_init(&index, filename));
+    CU_ASSERT_EQUAL(7, index.num_entries);
+    CU_ASSERT_EQUAL(1, chess_position_index_find_fen(&index, four_knights, &entries));
+    CU_ASSERT_EQUAL(6, entries[0].ply);
+    chess_position_index_cleanup(&index);
+
+    unlink(filename);
+    chess_game_destroy(game);
+    chess_position_index_builder_cleanup(&builder);
+    chess_pgn_loader_cleanup(&loader);
+    chess_buffer_reader_cleanup(&reader);
+}
+
+void test_position_index_add_tests(void)
+{
+    CU_Suite* suite = add_suite("position-index");
+    CU_add_test(suite, "position_index", (CU_TestFunc)test_position_index);
+    CU_add_test(suite, "position_index_spill", (CU_TestFunc)test_position_index_spill);
+    CU_add_test(suite, "position_index_defer_moves", (CU_TestFunc)test_position_index_defer_moves);
+}
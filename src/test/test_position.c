@@ -300,6 +300,138 @@ static void test_position_make_null_move(void)
     ASSERT_POSITIONS_EQUAL(&position, &positions[0]);
 }
 
+static ChessBoolean bitboards_match_pieces(const ChessPosition* position)
+{
+    ChessSquare sq;
+    ChessPiece pc;
+    ChessBitboard bb;
+
+    for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
+    {
+        bb = CHESS_BITBOARD_SQUARE(sq);
+        for (pc = CHESS_PIECE_WHITE_PAWN; pc <= CHESS_PIECE_BLACK_KING; pc++)
+        {
+            if (((position->bitboards[pc] & bb) != 0) != (position->piece[sq] == pc))
+                return CHESS_FALSE;
+        }
+        if (((position->occupied[CHESS_COLOR_WHITE] & bb) != 0)
+            != (position->piece[sq] != CHESS_PIECE_NONE && chess_piece_color(position->piece[sq]) == CHESS_COLOR_WHITE))
+            return CHESS_FALSE;
+        if (((position->occupied[CHESS_COLOR_BLACK] & bb) != 0)
+            != (position->piece[sq] != CHESS_PIECE_NONE && chess_piece_color(position->piece[sq]) == CHESS_COLOR_BLACK))
+            return CHESS_FALSE;
+    }
+    return CHESS_TRUE;
+}
+
+static void test_position_bitboards(void)
+{
+    ChessPosition position, start;
+    ChessUnmove unmoves[5];
+
+    chess_fen_load("r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1", &position);
+    chess_position_copy(&position, &start);
+    CU_ASSERT(bitboards_match_pieces(&position));
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_SQUARE(CHESS_SQUARE_E1), position.bitboards[CHESS_PIECE_WHITE_KING]);
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_SQUARE(CHESS_SQUARE_A8) | CHESS_BITBOARD_SQUARE(CHESS_SQUARE_H8),
+        position.bitboards[CHESS_PIECE_BLACK_ROOK]);
+
+    /* En passant capture */
+    unmoves[0] = chess_position_make_move(&position, MV(E5,D6));
+    CU_ASSERT(bitboards_match_pieces(&position));
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_EMPTY, position.bitboards[CHESS_PIECE_BLACK_PAWN]);
+
+    /* Castling */
+    unmoves[1] = chess_position_make_move(&position, MV(E8,C8));
+    CU_ASSERT(bitboards_match_pieces(&position));
+    unmoves[2] = chess_position_make_move(&position, MV(E1,G1));
+    CU_ASSERT(bitboards_match_pieces(&position));
+
+    /* Capture of a piece */
+    unmoves[3] = chess_position_make_move(&position, MV(D8,D6));
+    CU_ASSERT(bitboards_match_pieces(&position));
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_SQUARE(CHESS_SQUARE_B7), position.bitboards[CHESS_PIECE_WHITE_PAWN]);
+
+    /* Promotion */
+    unmoves[4] = chess_position_make_move(&position, MVP(B7,B8,KNIGHT));
+    CU_ASSERT(bitboards_match_pieces(&position));
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_EMPTY, position.bitboards[CHESS_PIECE_WHITE_PAWN]);
+    CU_ASSERT_EQUAL(CHESS_BITBOARD_SQUARE(CHESS_SQUARE_B8), position.bitboards[CHESS_PIECE_WHITE_KNIGHT]);
+
+    chess_position_undo_move(&position, unmoves[4]);
+    chess_position_undo_move(&position, unmoves[3]);
+    chess_position_undo_move(&position, unmoves[2]);
+    chess_position_undo_move(&position, unmoves[1]);
+    chess_position_undo_move(&position, unmoves[0]);
+    CU_ASSERT(bitboards_match_pieces(&position));
+    ASSERT_POSITIONS_EQUAL(&start, &position);
+}
+
+static ChessBoolean hash_matches_validated(const ChessPosition* position)
+{
+    ChessPosition temp_position;
+    chess_position_copy(position, &temp_position);
+    chess_position_validate(&temp_position);
+    return chess_position_hash(position) == chess_position_hash(&temp_position);
+}
+
+static void test_position_hash(void)
+{
+    ChessPosition position, start, other;
+    ChessUnmove unmoves[6];
+    ChessMove moves[6];
+    int i;
+
+    moves[0] = MV(E5,D6);
+    moves[1] = MV(E8,C8);
+    moves[2] = MV(E1,G1);
+    moves[3] = MV(D8,D6);
+    moves[4] = MVP(B7,B8,KNIGHT);
+    moves[5] = CHESS_MOVE_NULL;
+
+    chess_fen_load("r3k2r/1P6/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1", &position);
+    chess_position_copy(&position, &start);
+
+    /* The incremental hash always agrees with one computed from scratch */
+    for (i = 0; i < 6; i++)
+    {
+        unmoves[i] = chess_position_make_move(&position, moves[i]);
+        CU_ASSERT(hash_matches_validated(&position));
+        CU_ASSERT_NOT_EQUAL(chess_position_hash(&start), chess_position_hash(&position));
+    }
+    while (i-- > 0)
+        chess_position_undo_move(&position, unmoves[i]);
+    ASSERT_POSITIONS_EQUAL(&start, &position);
+
+    /* Transpositions hash the same */
+    chess_fen_load(CHESS_FEN_STARTING_POSITION, &position);
+    chess_position_make_move(&position, MV(G1,F3));
+    chess_position_make_move(&position, MV(G8,F6));
+    chess_position_make_move(&position, MV(B1,C3));
+    chess_fen_load(CHESS_FEN_STARTING_POSITION, &other);
+    chess_position_make_move(&other, MV(B1,C3));
+    chess_position_make_move(&other, MV(G8,F6));
+    chess_position_make_move(&other, MV(G1,F3));
+    CU_ASSERT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+
+    /* But not with a different side to move or castle rights */
+    chess_fen_load("rnbqkb1r/pppppppp/5n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R w KQkq - 2 3", &other);
+    CU_ASSERT_NOT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+    chess_fen_load("rnbqkb1r/pppppppp/5n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R b Kkq - 2 3", &other);
+    CU_ASSERT_NOT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+    chess_fen_load("rnbqkb1r/pppppppp/5n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R b KQkq - 2 3", &other);
+    CU_ASSERT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+
+    /* The ep file only counts when a pawn can take */
+    chess_fen_load(CHESS_FEN_STARTING_POSITION, &position);
+    chess_position_make_move(&position, MV(E2,E4));
+    chess_fen_load("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1", &other);
+    CU_ASSERT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+    chess_fen_load("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", &position);
+    chess_fen_load("4k3/8/8/3pP3/8/8/8/4K3 w - - 0 1", &other);
+    CU_ASSERT_NOT_EQUAL(chess_position_hash(&position), chess_position_hash(&other));
+}
+
 void test_position_check_result(void)
 {
     ChessPosition position;
@@ -338,4 +470,6 @@ void test_position_add_tests(void)
     CU_add_test(suite, "position_make_null_move", (CU_TestFunc)test_position_make_null_move);
     CU_add_test(suite, "position_make_move", (CU_TestFunc)test_position_make_move);
     CU_add_test(suite, "position_check_result", (CU_TestFunc)test_position_check_result);
+    CU_add_test(suite, "position_bitboards", (CU_TestFunc)test_position_bitboards);
+    CU_add_test(suite, "position_hash", (CU_TestFunc)test_position_hash);
 }
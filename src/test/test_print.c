@@ -1,3 +1,6 @@
+#include <stdio.h>
+#include <string.h>
+
 #include <CUnit/CUnit.h>
 
 #include "../fen.h"
@@ -63,6 +66,24 @@ static void test_print_move_san(void)
     chess_print_move_san(move, &position, buf);
     CU_ASSERT_STRING_EQUAL("Qaxa4+", buf);
 
+    /* A pinned knight doesn't make the other one ambiguous */
+    chess_fen_load("4k3/8/8/8/1b6/8/3N4/4K1N1 w - - 0 1", &position);
+    chess_print_move_san(MV(G1,F3), &position, buf);
+    CU_ASSERT_STRING_EQUAL("Nf3", buf);
+
+    /* Mate, unless the check can be blocked */
+    chess_fen_load("6k1/5ppp/8/8/8/8/8/R3K3 w - - 0 1", &position);
+    chess_print_move_san(MV(A1,A8), &position, buf);
+    CU_ASSERT_STRING_EQUAL("Ra8#", buf);
+    chess_fen_load("6k1/3n1ppp/8/8/8/8/8/R3K3 w - - 0 1", &position);
+    chess_print_move_san(MV(A1,A8), &position, buf);
+    CU_ASSERT_STRING_EQUAL("Ra8+", buf);
+
+    /* Castling can check too */
+    chess_fen_load("5k2/8/8/8/8/8/8/4K2R w K - 0 1", &position);
+    chess_print_move_san(MV(E1,G1), &position, buf);
+    CU_ASSERT_STRING_EQUAL("O-O+", buf);
+
     /* TODO test ambiguous ep capture e.g. cxd6 vs exd6 */
 }
 
@@ -178,6 +199,60 @@ static void test_print_game_moves_nags(void)
     chess_game_destroy(game);
 }
 
+static void test_print_game_moves_compact(void)
+{
+    ChessGame* game;
+    ChessBufferWriter writer;
+
+    chess_buffer_writer_init(&writer);
+    game = chess_game_new();
+    chess_game_append_move(game, MV(G1,F3));
+    chess_game_append_move(game, MV(D7,D5));
+    chess_game_append_move(game, MV(C2,C4));
+    chess_print_game_moves(game, (ChessWriter*)&writer);
+    ASSERT_BUFFER_VALUE(&writer, "1. Nf3 d5 2. c4 *");
+    CU_ASSERT(chess_game_is_compact(game));
+
+    chess_buffer_writer_clear(&writer);
+    chess_game_reset_fen(game, "5k2/3b2p1/1p4qp/p1pPp1pn/P1P1P3/2PQ4/6PP/3BB1K1 b - - 1 26");
+    chess_game_append_move(game, MV(H5,F4));
+    chess_game_append_move(game, MV(D3,C2));
+    chess_game_set_result(game, CHESS_RESULT_DRAW);
+    chess_print_game_moves(game, (ChessWriter*)&writer);
+    ASSERT_BUFFER_VALUE(&writer, "26... Nf4 27. Qc2 1/2-1/2");
+
+    chess_buffer_writer_cleanup(&writer);
+    chess_game_destroy(game);
+}
+
+static void test_print_game_moves_long(void)
+{
+    const ChessMove moves[] = { MV(G1,F3), MV(G8,F6), MV(F3,G1), MV(F6,G8) };
+    const char* sans[] = { "Nf3", "Nf6", "Ng1", "Ng8" };
+    ChessGame* game;
+    ChessBufferWriter writer;
+    char expected[8192], *s = expected;
+    int i;
+
+    /* Longer than the printer keeps before writing */
+    game = chess_game_new();
+    for (i = 0; i < 1000; i++)
+    {
+        chess_game_append_move(game, moves[i % 4]);
+        if (i % 2 == 0)
+            s += sprintf(s, "%d. ", i / 2 + 1);
+        s += sprintf(s, "%s ", sans[i % 4]);
+    }
+    strcpy(s, "*");
+
+    chess_buffer_writer_init(&writer);
+    chess_print_game_moves(game, (ChessWriter*)&writer);
+    ASSERT_BUFFER_VALUE(&writer, expected);
+
+    chess_buffer_writer_cleanup(&writer);
+    chess_game_destroy(game);
+}
+
 static void test_print_result(void)
 {
     char buf[10];
@@ -200,5 +275,7 @@ void test_print_add_tests(void)
     CU_add_test(suite, "print_game_moves", (CU_TestFunc)test_print_game_moves);
     CU_add_test(suite, "print_game_moves_nested", (CU_TestFunc)test_print_game_moves_nested);
     CU_add_test(suite, "print_game_moves_nags", (CU_TestFunc)test_print_game_moves_nags);
+    CU_add_test(suite, "print_game_moves_compact", (CU_TestFunc)test_print_game_moves_compact);
+    CU_add_test(suite, "print_game_moves_long", (CU_TestFunc)test_print_game_moves_long);
     CU_add_test(suite, "print_result", (CU_TestFunc)test_print_result);
 }
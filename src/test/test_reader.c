@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <CUnit/CUnit.h>
@@ -81,9 +83,92 @@ static void test_file_reader(void)
     fclose(file);
 }
 
+static void test_buffer_reader_binary(void)
+{
+    ChessBufferReader reader;
+
+    /* A 0xff byte must not be mistaken for the end */
+    chess_buffer_reader_init_size(&reader, "a\xff\0b", 4);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 'a');
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 0xff);
+    chess_reader_ungetc((ChessReader*)&reader, 0xff);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 0xff);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 0);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 'b');
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), EOF);
+    chess_buffer_reader_cleanup(&reader);
+}
+
+static void test_reader_span(void)
+{
+    ChessBufferReader reader;
+    ChessFileReader file_reader;
+    const char* data;
+
+    chess_buffer_reader_init(&reader, "1. e4 e5");
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), '1');
+    CU_ASSERT_EQUAL(7, chess_reader_span((ChessReader*)&reader, &data));
+    CU_ASSERT(!strncmp(data, ". e4 e5", 7));
+
+    /* Nothing is used up until skipped */
+    chess_reader_skip((ChessReader*)&reader, 3);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), '4');
+
+    /* A character pushed back has to be read normally first */
+    chess_reader_ungetc((ChessReader*)&reader, '4');
+    CU_ASSERT_EQUAL(0, chess_reader_span((ChessReader*)&reader, &data));
+    CU_ASSERT(data == NULL);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), '4');
+    CU_ASSERT_EQUAL(3, chess_reader_span((ChessReader*)&reader, &data));
+    chess_reader_skip((ChessReader*)&reader, 3);
+
+    /* At the end there's an empty span, not none */
+    CU_ASSERT_EQUAL(0, chess_reader_span((ChessReader*)&reader, &data));
+    CU_ASSERT(data != NULL);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), EOF);
+    chess_buffer_reader_cleanup(&reader);
+
+    /* Files can't lend anything */
+    chess_file_reader_init(&file_reader, stdin);
+    CU_ASSERT_EQUAL(0, chess_reader_span((ChessReader*)&file_reader, &data));
+    CU_ASSERT(data == NULL);
+    chess_file_reader_cleanup(&file_reader);
+}
+
+static void test_mapped_reader(void)
+{
+    ChessMappedReader reader;
+    char filename[TEMP_FILE_NAME_SIZE];
+    const char* data;
+
+    make_temp_file(filename, "[Event \"?\"]");
+
+    CU_ASSERT(chess_mapped_reader_init(&reader, filename));
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), '[');
+    CU_ASSERT_EQUAL(chess_reader_peek((ChessReader*)&reader), 'E');
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), 'E');
+    CU_ASSERT_EQUAL(9, chess_reader_span((ChessReader*)&reader, &data));
+    CU_ASSERT(!strncmp(data, "vent \"?\"]", 9));
+    chess_reader_skip((ChessReader*)&reader, 9);
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), EOF);
+    chess_mapped_reader_cleanup(&reader);
+
+    /* Empty files read as nothing */
+    write_file(filename, "");
+    CU_ASSERT(chess_mapped_reader_init(&reader, filename));
+    CU_ASSERT_EQUAL(chess_reader_getc((ChessReader*)&reader), EOF);
+    chess_mapped_reader_cleanup(&reader);
+
+    unlink(filename);
+    CU_ASSERT(!chess_mapped_reader_init(&reader, filename));
+}
+
 void test_reader_add_tests(void)
 {
     CU_Suite* suite = add_suite("reader");
     CU_add_test(suite, "buffer_reader", (CU_TestFunc)test_buffer_reader);
     CU_add_test(suite, "file_reader", (CU_TestFunc)test_file_reader);
+    CU_add_test(suite, "buffer_reader_binary", (CU_TestFunc)test_buffer_reader_binary);
+    CU_add_test(suite, "reader_span", (CU_TestFunc)test_reader_span);
+    CU_add_test(suite, "mapped_reader", (CU_TestFunc)test_mapped_reader);
 }
@@ -319,6 +319,157 @@ static void test_promote(void)
     chess_variation_destroy(root);
 }
 
+static void test_comment(void)
+{
+    ChessVariation* root, *child;
+    ChessArena arena;
+
+    root = chess_variation_new();
+    child = chess_variation_add_child(root, MV(E2,E4));
+    chess_variation_set_comment(child, "Best by test", 4);
+    CU_ASSERT_EQUAL(4, child->comment.size);
+    CU_ASSERT_STRING_EQUAL("Best", child->comment.data);
+    chess_variation_destroy(root);
+
+    chess_arena_init(&arena);
+    root = chess_variation_new_arena(&arena);
+    child = chess_variation_add_child(root, MV(E2,E4));
+    chess_variation_set_comment(child, "Best by test", 12);
+    CU_ASSERT_STRING_EQUAL("Best by test", child->comment.data);
+    chess_variation_set_comment(child, "", 0);
+    CU_ASSERT_STRING_EQUAL("", child->comment.data);
+    chess_variation_destroy(root);
+    chess_arena_cleanup(&arena);
+}
+
+static void test_arena(void)
+{
+    ChessVariation* root, *child, *child2, *grandchild;
+    ChessArena arena;
+
+    chess_arena_init(&arena);
+    root = chess_variation_new_arena(&arena);
+    child = chess_variation_add_child(root, MV(E2,E4));
+    child2 = chess_variation_add_child(root, MV(D2,D4));
+    grandchild = chess_variation_add_child(child, MV(C7,C5));
+    chess_variation_add_child(child, MV(E7,E6));
+    CU_ASSERT_EQUAL(root, grandchild->root);
+    CU_ASSERT_EQUAL(2, chess_variation_num_children(root));
+    CU_ASSERT_EQUAL(2, chess_variation_length(root));
+
+    chess_variation_delete(child2);
+    CU_ASSERT_EQUAL(1, chess_variation_num_children(root));
+    chess_variation_truncate(child);
+    CU_ASSERT_EQUAL(1, chess_variation_length(root));
+
+    /* The tree can be rebuilt after the arena is reset */
+    chess_variation_truncate(root);
+    chess_arena_reset(&arena);
+    child = chess_variation_add_child(root, MV(G1,F3));
+    chess_variation_add_child(child, MV(G8,F6));
+    CU_ASSERT_EQUAL(2, chess_variation_length(root));
+    CU_ASSERT_EQUAL(MV(G8,F6), chess_variation_ply(root, 1)->move);
+
+    chess_variation_destroy(root);
+    chess_arena_cleanup(&arena);
+}
+
+static void test_attach_subvariation(void)
+{
+    ChessVariation* root, *sub, *child, *node;
+    ChessArena arena;
+
+    /* Into an arena tree, the nodes are copied */
+    chess_arena_init(&arena);
+    root = chess_variation_new_arena(&arena);
+    chess_variation_add_child(root, MV(D2,D4));
+    sub = chess_variation_new();
+    child = chess_variation_add_child(sub, MV(E2,E4));
+    chess_variation_add_child(child, MV(E7,E5));
+    chess_variation_add_child(child, MV(C7,C5));
+    chess_variation_add_annotation(child, 1);
+    chess_variation_set_comment(child, "Best by test", 12);
+    chess_variation_add_child(sub, MV(C2,C4));
+    chess_variation_attach_subvariation(root, sub);
+
+    CU_ASSERT_EQUAL(3, chess_variation_num_children(root));
+    node = root->first_child->right;
+    CU_ASSERT_EQUAL(MV(E2,E4), node->move);
+    CU_ASSERT_EQUAL(root, node->parent);
+    CU_ASSERT_EQUAL(root, node->root);
+    CU_ASSERT_EQUAL(1, node->annotations[0]);
+    CU_ASSERT_STRING_EQUAL("Best by test", node->comment.data);
+    CU_ASSERT_EQUAL(2, chess_variation_num_children(node));
+    CU_ASSERT_EQUAL(MV(E7,E5), node->first_child->move);
+    CU_ASSERT_EQUAL(MV(C7,C5), node->first_child->right->move);
+    CU_ASSERT_EQUAL(root, node->first_child->right->root);
+    CU_ASSERT_EQUAL(MV(C2,C4), node->right->move);
+    chess_variation_destroy(root);
+    chess_arena_cleanup(&arena);
+
+    /* Between plain trees, they're moved */
+    root = chess_variation_new();
+    sub = chess_variation_new();
+    child = chess_variation_add_child(sub, MV(E2,E4));
+    node = chess_variation_add_child(child, MV(E7,E5));
+    chess_variation_add_child(child, MV(C7,C5));
+    chess_variation_attach_subvariation(root, sub);
+    CU_ASSERT_EQUAL(child, root->first_child);
+    CU_ASSERT_EQUAL(root, child->parent);
+    CU_ASSERT_EQUAL(root, node->root);
+    CU_ASSERT_EQUAL(root, node->right->root);
+    chess_variation_destroy(root);
+}
+
+typedef struct
+{
+    ChessVariation* node; /* the last one changed */
+    int count;
+} Changes;
+
+static void record_change(void* data, ChessVariation* node)
+{
+    Changes* changes = (Changes*)data;
+    changes->node = node;
+    changes->count++;
+}
+
+static void test_changed(void)
+{
+    ChessVariation* root, *child, *child2;
+    Changes changes;
+
+    root = chess_variation_new();
+    changes.node = NULL;
+    changes.count = 0;
+    chess_variation_set_changed_func(root, record_change, &changes);
+    child = chess_variation_add_child(root, MV(E2,E4));
+    CU_ASSERT_EQUAL(root, changes.node);
+    CU_ASSERT_EQUAL(1, changes.count);
+
+    /* Adding a move that's already there changes nothing */
+    chess_variation_add_child(root, MV(E2,E4));
+    chess_variation_add_annotation(child, 1);
+    CU_ASSERT_EQUAL(1, changes.count);
+
+    /* The node passed is the one whose children changed */
+    child2 = chess_variation_add_child(root, MV(D2,D4));
+    CU_ASSERT_EQUAL(root, changes.node);
+    changes.node = NULL;
+    chess_variation_promote(child2);
+    CU_ASSERT_EQUAL(root, changes.node);
+    chess_variation_add_child(child, MV(E7,E5));
+    CU_ASSERT_EQUAL(child, changes.node);
+    changes.node = NULL;
+    chess_variation_truncate(child);
+    CU_ASSERT_EQUAL(child, changes.node);
+    chess_variation_delete(child);
+    CU_ASSERT_EQUAL(root, changes.node);
+    CU_ASSERT_EQUAL(6, changes.count);
+
+    chess_variation_destroy(root);
+}
+
 void test_variation_add_tests(void)
 {
     CU_Suite* suite = add_suite("variation");
@@ -332,4 +483,8 @@ void test_variation_add_tests(void)
     CU_add_test(suite, "truncate", (CU_TestFunc)test_truncate);
     CU_add_test(suite, "promote", (CU_TestFunc)test_promote);
     CU_add_test(suite, "delete", (CU_TestFunc)test_delete);
+    CU_add_test(suite, "comment", (CU_TestFunc)test_comment);
+    CU_add_test(suite, "arena", (CU_TestFunc)test_arena);
+    CU_add_test(suite, "attach_subvariation", (CU_TestFunc)test_attach_subvariation);
+    CU_add_test(suite, "changed", (CU_TestFunc)test_changed);
 }
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <CUnit/CUnit.h>
@@ -114,6 +115,49 @@ static void test_file_writer_write(void)
     fclose(file);
 }
 
+static void test_fd_writer_write(void)
+{
+    ChessFdWriter writer;
+    char filename[TEMP_FILE_NAME_SIZE];
+    char data[128];
+    FILE* file;
+    int fd;
+
+    make_temp_file(filename, "");
+    fd = open(filename, O_WRONLY);
+    assert(fd >= 0);
+
+    /* Nothing goes out until a block of 8 fills */
+    chess_fd_writer_init(&writer, fd, 8);
+    chess_writer_write_char((ChessWriter*)&writer, 'A');
+    chess_writer_write_char((ChessWriter*)&writer, '!');
+    chess_writer_write_string((ChessWriter*)&writer, "(cake)");
+    CU_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_CUR));
+    chess_writer_write_string_size((ChessWriter*)&writer, "LIONESS", 4);
+    CU_ASSERT_EQUAL(8, lseek(fd, 0, SEEK_CUR));
+    chess_writer_write_string((ChessWriter*)&writer, " longer than a block");
+    CU_ASSERT_EQUAL(32, lseek(fd, 0, SEEK_CUR));
+    chess_writer_write_char((ChessWriter*)&writer, '.');
+    CU_ASSERT(chess_writer_flush((ChessWriter*)&writer));
+    CU_ASSERT_EQUAL(33, lseek(fd, 0, SEEK_CUR));
+    chess_writer_write_char((ChessWriter*)&writer, '\n');
+    chess_fd_writer_cleanup(&writer);
+    close(fd);
+
+    file = fopen(filename, "r");
+    assert(file != NULL);
+    CU_ASSERT(fgets(data, 128, file) != NULL);
+    CU_ASSERT_STRING_EQUAL("A!(cake)LION longer than a block.\n", data);
+    fclose(file);
+    unlink(filename);
+
+    /* Writing to a closed descriptor fails */
+    chess_fd_writer_init(&writer, fd, 0);
+    chess_writer_write_char((ChessWriter*)&writer, 'A');
+    CU_ASSERT(!chess_writer_flush((ChessWriter*)&writer));
+    chess_fd_writer_cleanup(&writer);
+}
+
 void test_writer_add_tests(void)
 {
     CU_Suite* suite = add_suite("writer");
@@ -122,4 +166,5 @@ void test_writer_add_tests(void)
     CU_add_test(suite, "buffer_writer_clear", (CU_TestFunc)test_buffer_writer_clear);
     CU_add_test(suite, "buffer_writer_detach", (CU_TestFunc)test_buffer_writer_detach);
     CU_add_test(suite, "file_writer_write", (CU_TestFunc)test_file_writer_write);
+    CU_add_test(suite, "fd_writer_write", (CU_TestFunc)test_fd_writer_write);
 }
@@ -5,12 +5,15 @@
 #include "chess.h"
 #include "move.h"
 #include "calloc.h"
+#include "carena.h"
 #include "cstring.h"
 #include "variation.h"
 
 static ChessVariation* new_node(ChessVariation* root)
 {
-    ChessVariation* variation = chess_alloc(sizeof(ChessVariation));
+    ChessVariation* variation = (root && root->arena)
+        ? chess_arena_alloc(root->arena, sizeof(ChessVariation))
+        : chess_alloc(sizeof(ChessVariation));
     memset(variation, 0, sizeof(ChessVariation));
     variation->root = root;
     chess_string_init(&variation->comment);
@@ -19,8 +22,16 @@ static ChessVariation* new_node(ChessVariation* root)
 
 static void free_node(ChessVariation* node)
 {
-    chess_string_cleanup(&node->comment);
-    chess_free(node);
+    /* In an arena tree only the root has memory of its own */
+    if (node->root->arena == NULL)
+    {
+        chess_string_cleanup(&node->comment);
+        chess_free(node);
+    }
+    else if (node == node->root)
+    {
+        chess_free(node);
+    }
 }
 
 static void free_node_tree(ChessVariation* node)
@@ -53,6 +64,13 @@ static void free_node_tree(ChessVariation* node)
     }
 }
 
+static void tree_changed(ChessVariation* node)
+{
+    ChessVariation* root = node->root;
+    if (root->changed)
+        root->changed(root->changed_data, node);
+}
+
 typedef void(*NodeVisitor)(ChessVariation*, void*);
 static void for_each_node(ChessVariation* start, NodeVisitor visitor, void* closure)
 {
@@ -69,7 +87,7 @@ static void for_each_node(ChessVariation* start, NodeVisitor visitor, void* clos
 
         /* No more children, move back until we reach start, or a node with a sibling
            to move down */
-        while (node != start && node->right != NULL)
+        while (node != start && node->right == NULL)
             node = node->parent;
 
         if (node == start)
@@ -86,10 +104,27 @@ ChessVariation* chess_variation_new(void)
     return variation;
 }
 
+ChessVariation* chess_variation_new_arena(ChessArena* arena)
+{
+    ChessVariation* variation = chess_variation_new();
+    variation->arena = arena;
+    return variation;
+}
+
 void chess_variation_destroy(ChessVariation* variation)
 {
     assert(chess_variation_is_root(variation));
-    free_node_tree(variation);
+    if (variation->arena)
+        free_node(variation);
+    else
+        free_node_tree(variation);
+}
+
+void chess_variation_set_changed_func(ChessVariation* root, ChessVariationChangedFunc func, void* data)
+{
+    assert(chess_variation_is_root(root));
+    root->changed = func;
+    root->changed_data = data;
 }
 
 ChessBoolean chess_variation_is_root(const ChessVariation* variation)
@@ -180,6 +215,30 @@ void chess_variation_remove_annotation(ChessVariation* variation, ChessAnnotatio
     }
 }
 
+void chess_variation_set_comment(ChessVariation* variation, const char* s, size_t n)
+{
+    ChessArena* arena;
+    char* buf;
+
+    assert(variation != NULL);
+    arena = variation->root->arena;
+    if (arena == NULL)
+    {
+        chess_string_assign_size(&variation->comment, s, n);
+        return;
+    }
+
+    chess_string_init(&variation->comment);
+    if (n > 0)
+    {
+        buf = chess_arena_alloc(arena, n + 1);
+        memcpy(buf, s, n);
+        buf[n] = '\0';
+        variation->comment.size = n;
+        variation->comment.data = buf;
+    }
+}
+
 static ChessVariation* chess_variation_add_sibling(ChessVariation* variation, ChessMove move)
 {
     ChessVariation* sibling;
@@ -199,6 +258,7 @@ static ChessVariation* chess_variation_add_sibling(ChessVariation* variation, Ch
     sibling->left = variation;
     sibling->parent = variation->parent;
     variation->right = sibling;
+    tree_changed(sibling->parent);
     return sibling;
 }
 
@@ -214,6 +274,7 @@ ChessVariation* chess_variation_add_child(ChessVariation* variation, ChessMove m
     child->move = move;
     child->parent = variation;
     variation->first_child = child;
+    tree_changed(variation);
     return child;
 }
 
@@ -222,12 +283,70 @@ static void set_node_root(ChessVariation* node, ChessVariation* root)
     node->root = root;
 }
 
+static ChessVariation* append_copy(ChessVariation* parent, const ChessVariation* node)
+{
+    ChessVariation* copy = new_node(parent->root);
+    ChessVariation* child = parent->first_child;
+
+    copy->move = node->move;
+    memcpy(copy->annotations, node->annotations, sizeof(copy->annotations));
+    if (node->comment.size > 0)
+        chess_variation_set_comment(copy, node->comment.data, node->comment.size);
+
+    copy->parent = parent;
+    if (child == NULL)
+    {
+        parent->first_child = copy;
+        return copy;
+    }
+    while (child->right != NULL)
+        child = child->right;
+    child->right = copy;
+    copy->left = child;
+    return copy;
+}
+
+static void copy_children(ChessVariation* variation, const ChessVariation* start)
+{
+    /* Walk the tree keeping copy as the copy of the node last visited */
+    const ChessVariation* node = start->first_child;
+    ChessVariation* copy = variation;
+    while (node != NULL)
+    {
+        copy = append_copy(copy, node);
+        if (node->first_child != NULL)
+        {
+            node = node->first_child;
+            continue;
+        }
+
+        while (node != start && node->right == NULL)
+        {
+            node = node->parent;
+            copy = copy->parent;
+        }
+        if (node == start)
+            break;
+        node = node->right;
+        copy = copy->parent;
+    }
+}
+
 void chess_variation_attach_subvariation(ChessVariation* variation, ChessVariation* subvariation)
 {
     ChessVariation* child, *attach_point;
     assert(variation != NULL);
     assert(chess_variation_is_root(subvariation));
 
+    if (subvariation->arena != variation->root->arena)
+    {
+        /* Nodes can't move between allocators */
+        copy_children(variation, subvariation);
+        tree_changed(variation);
+        chess_variation_destroy(subvariation);
+        return;
+    }
+
     /* Set the root of all nodes in subvariation to variation->root */
     for_each_node(subvariation, (NodeVisitor)set_node_root, variation->root);
 
@@ -246,15 +365,17 @@ void chess_variation_attach_subvariation(ChessVariation* variation, ChessVariati
     {
         /* Attach directly under variation */
         variation->first_child = attach_point;
-        return;
     }
+    else
+    {
+        /* Attach to the right of existing child */
+        while (child->right != NULL)
+            child = child->right;
 
-    /* Attach to the right of existing child */
-    while (child->right != NULL)
-        child = child->right;
-
-    child->right = attach_point;
-    attach_point->left = child;
+        child->right = attach_point;
+        attach_point->left = child;
+    }
+    tree_changed(variation);
 }
 
 void chess_variation_truncate(ChessVariation* variation)
@@ -263,13 +384,17 @@ void chess_variation_truncate(ChessVariation* variation)
     assert(variation != NULL);
     if (variation->first_child != NULL)
     {
-        free_node_tree(variation->first_child);
+        if (variation->root->arena == NULL)
+            free_node_tree(variation->first_child);
         variation->first_child = NULL;
+        tree_changed(variation);
     }
 }
 
 void chess_variation_delete(ChessVariation* variation)
 {
+    ChessVariation* parent = variation->parent;
+
     /* Delete all subvariations, then remove the node itself */
     assert(!chess_variation_is_root(variation));
     chess_variation_truncate(variation);
@@ -282,12 +407,13 @@ void chess_variation_delete(ChessVariation* variation)
     }
     else
     {
-        assert(variation->parent->first_child == variation);
-        variation->parent->first_child = variation->right;
+        assert(parent->first_child == variation);
+        parent->first_child = variation->right;
         if (variation->right != NULL)
             variation->right->left = NULL;
     }
     free_node(variation);
+    tree_changed(parent);
 }
 
 void chess_variation_promote(ChessVariation* variation)
@@ -310,4 +436,5 @@ void chess_variation_promote(ChessVariation* variation)
     variation->right = sibling;
     variation->left = NULL;
     variation->parent->first_child = variation;
+    tree_changed(variation->parent);
 }
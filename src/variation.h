@@ -2,11 +2,16 @@
 #define CHESSLIB_VARIATION_H_
 
 #include "move.h"
+#include "carena.h"
 #include "cstring.h"
 
 typedef unsigned char ChessAnnotation;
 
 typedef struct ChessVariation ChessVariation;
+
+/* Called after the children of a node change: added, removed or reordered */
+typedef void (*ChessVariationChangedFunc)(void* data, ChessVariation* node);
+
 struct ChessVariation
 {
     ChessMove move;
@@ -17,11 +22,23 @@ struct ChessVariation
     ChessVariation* first_child;
     ChessVariation* left;
     ChessVariation* right;
+    ChessArena* arena; /* only set on the root */
+    ChessVariationChangedFunc changed; /* only set on the root */
+    void* changed_data;
 };
 
 ChessVariation* chess_variation_new(void);
+
+/* Every node but the root is allocated from the arena, and deleting them
+ * gives nothing back until the arena is reset. The arena must outlive the
+ * tree. */
+ChessVariation* chess_variation_new_arena(ChessArena*);
 void chess_variation_destroy(ChessVariation*);
 
+/* Lets the owner of a tree keep anything it works out from the tree's shape
+ * up to date. The function is kept by the root. */
+void chess_variation_set_changed_func(ChessVariation* root, ChessVariationChangedFunc, void* data);
+
 ChessBoolean chess_variation_is_root(const ChessVariation*);
 size_t chess_variation_annotations(const ChessVariation*, ChessAnnotation*);
 
@@ -31,8 +48,12 @@ ChessVariation* chess_variation_ply(ChessVariation*, size_t ply);
 
 void chess_variation_add_annotation(ChessVariation*, ChessAnnotation);
 void chess_variation_remove_annotation(ChessVariation*, ChessAnnotation);
+void chess_variation_set_comment(ChessVariation*, const char* s, size_t n);
 
 ChessVariation* chess_variation_add_child(ChessVariation*, ChessMove);
+
+/* Takes ownership of the subvariation, whose nodes are copied if it doesn't
+ * share the tree's arena */
 void chess_variation_attach_subvariation(ChessVariation*, ChessVariation*);
 void chess_variation_truncate(ChessVariation*);
 void chess_variation_delete(ChessVariation*);
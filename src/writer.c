@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "writer.h"
 #include "calloc.h"
@@ -9,12 +11,14 @@
 typedef void(*WriteCharFunc)(ChessWriter*, char);
 typedef void(*WriteStringFunc)(ChessWriter*, const char*);
 typedef void(*WriteStringSizeFunc)(ChessWriter*, const char*, size_t);
+typedef ChessBoolean(*FlushFunc)(ChessWriter*);
 
 typedef struct
 {
     WriteCharFunc write_char;
     WriteStringFunc write_string;
     WriteStringSizeFunc write_string_size;
+    FlushFunc flush;
 } WriterVtable;
 
 void chess_writer_write_char(ChessWriter* writer, char c)
@@ -32,6 +36,11 @@ void chess_writer_write_string_size(ChessWriter* writer, const char* str, size_t
     ((WriterVtable*)writer->vtable)->write_string_size(writer, str, size);
 }
 
+ChessBoolean chess_writer_flush(ChessWriter* writer)
+{
+    return ((WriterVtable*)writer->vtable)->flush(writer);
+}
+
 static void file_writer_write_char(ChessFileWriter* writer, char c)
 {
     fputc(c, writer->file);
@@ -47,10 +56,16 @@ static void file_writer_write_string_size(ChessFileWriter* writer, const char* s
     fwrite(str, 1, size, writer->file);
 }
 
+static ChessBoolean file_writer_flush(ChessFileWriter* writer)
+{
+    return fflush(writer->file) == 0 && !ferror(writer->file);
+}
+
 static WriterVtable file_writer_vtable = {
     (WriteCharFunc)&file_writer_write_char,
     (WriteStringFunc)&file_writer_write_string,
-    (WriteStringSizeFunc)&file_writer_write_string_size
+    (WriteStringSizeFunc)&file_writer_write_string_size,
+    (FlushFunc)&file_writer_flush
 };
 
 void chess_file_writer_init(ChessFileWriter* writer, FILE* file)
@@ -102,10 +117,16 @@ static void buffer_writer_write_string(ChessBufferWriter* writer, const char* st
     buffer_writer_write_string_size(writer, str, strlen(str));
 }
 
+static ChessBoolean buffer_writer_flush(ChessBufferWriter* writer)
+{
+    return CHESS_TRUE;
+}
+
 static WriterVtable buffer_writer_vtable = {
     (WriteCharFunc)&buffer_writer_write_char,
     (WriteStringFunc)&buffer_writer_write_string,
-    (WriteStringSizeFunc)&buffer_writer_write_string_size
+    (WriteStringSizeFunc)&buffer_writer_write_string_size,
+    (FlushFunc)&buffer_writer_flush
 };
 
 void chess_buffer_writer_init(ChessBufferWriter* writer)
@@ -143,3 +164,84 @@ char* chess_buffer_writer_detach_buffer(ChessBufferWriter* writer)
     chess_buffer_writer_init(writer);
     return buffer;
 }
+
+#define FD_WRITER_BLOCK_SIZE (1 << 20)
+
+static void fd_writer_write_all(ChessFdWriter* writer, const char* data, size_t size)
+{
+    ssize_t written;
+
+    while (size > 0 && !writer->failed)
+    {
+        written = write(writer->fd, data, size);
+        if (written <= 0)
+        {
+            /* Writing nothing would only repeat forever */
+            if (written == 0 || errno != EINTR)
+                writer->failed = CHESS_TRUE;
+            continue;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+static ChessBoolean fd_writer_flush(ChessFdWriter* writer)
+{
+    fd_writer_write_all(writer, writer->buffer, writer->size);
+    writer->size = 0;
+    return !writer->failed;
+}
+
+static void fd_writer_write_string_size(ChessFdWriter* writer, const char* str, size_t size)
+{
+    if (writer->size + size > writer->block_size)
+    {
+        fd_writer_flush(writer);
+
+        /* Anything at least a block long may as well go straight out */
+        if (size >= writer->block_size)
+        {
+            fd_writer_write_all(writer, str, size);
+            return;
+        }
+    }
+
+    memcpy(writer->buffer + writer->size, str, size);
+    writer->size += size;
+}
+
+static void fd_writer_write_char(ChessFdWriter* writer, char c)
+{
+    if (writer->size == writer->block_size)
+        fd_writer_flush(writer);
+    writer->buffer[writer->size++] = c;
+}
+
+static void fd_writer_write_string(ChessFdWriter* writer, const char* str)
+{
+    fd_writer_write_string_size(writer, str, strlen(str));
+}
+
+static WriterVtable fd_writer_vtable = {
+    (WriteCharFunc)&fd_writer_write_char,
+    (WriteStringFunc)&fd_writer_write_string,
+    (WriteStringSizeFunc)&fd_writer_write_string_size,
+    (FlushFunc)&fd_writer_flush
+};
+
+void chess_fd_writer_init(ChessFdWriter* writer, int fd, size_t block_size)
+{
+    writer->base.vtable = &fd_writer_vtable;
+    writer->fd = fd;
+    writer->block_size = block_size ? block_size : FD_WRITER_BLOCK_SIZE;
+    writer->buffer = chess_alloc(writer->block_size);
+    writer->size = 0;
+    writer->failed = CHESS_FALSE;
+}
+
+void chess_fd_writer_cleanup(ChessFdWriter* writer)
+{
+    fd_writer_flush(writer);
+    chess_free(writer->buffer);
+}
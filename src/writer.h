@@ -1,6 +1,11 @@
 #ifndef CHESSLIB_WRITER_H_
 #define CHESSLIB_WRITER_H_
 
+#include <stddef.h>
+#include <stdio.h>
+
+#include "chess.h"
+
 typedef struct
 {
     void* vtable;
@@ -9,6 +14,9 @@ typedef struct
 void chess_writer_write_char(ChessWriter*, char);
 void chess_writer_write_string(ChessWriter*, const char*);
 void chess_writer_write_string_size(ChessWriter*, const char*, size_t);
+/* Passes on anything the writer is holding back. Returns CHESS_FALSE if
+ * any of what was written so far couldn't be. */
+ChessBoolean chess_writer_flush(ChessWriter*);
 
 typedef struct
 {
@@ -36,4 +44,20 @@ size_t chess_buffer_writer_size(const ChessBufferWriter*);
 void chess_buffer_writer_clear(ChessBufferWriter*);
 char* chess_buffer_writer_detach_buffer(ChessBufferWriter*);
 
+/* Collects writes in blocks of block_size bytes, or 1MB if 0, and hands
+ * each full block straight to write(2). Cleanup flushes but doesn't close
+ * the file descriptor. */
+typedef struct
+{
+    ChessWriter base;
+    int fd;
+    char* buffer;
+    size_t block_size;
+    size_t size;
+    ChessBoolean failed;
+} ChessFdWriter;
+
+void chess_fd_writer_init(ChessFdWriter*, int fd, size_t block_size);
+void chess_fd_writer_cleanup(ChessFdWriter*);
+
 #endif /* CHESSLIB_WRITER_H_ */
@@ -0,0 +1,39 @@
+#include "zobrist.h"
+
+ChessZobristKeys chess_zobrist_keys;
+
+/* xorshift64*, which is plenty for keys that only need to look random */
+static ChessHash next_key(ChessHash* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * (((ChessHash)0x2545f491 << 32) | 0x4f6cdd1d);
+}
+
+void chess_zobrist_init(void)
+{
+    ChessHash state = ((ChessHash)0x9e3779b9 << 32) | 0x7f4a7c15;
+    int piece, sq, i;
+
+    /* Any change to the order here changes every stored hash */
+    for (piece = CHESS_PIECE_WHITE_PAWN; piece <= CHESS_PIECE_BLACK_KING; piece++)
+    {
+        for (sq = CHESS_SQUARE_A1; sq <= CHESS_SQUARE_H8; sq++)
+            chess_zobrist_keys.piece[piece][sq] = next_key(&state);
+    }
+
+    /* Each castle state gets the combined keys of its rights */
+    for (i = 0; i < 4; i++)
+        chess_zobrist_keys.castle[1 << i] = next_key(&state);
+    for (i = 1; i < 16; i++)
+    {
+        chess_zobrist_keys.castle[i] = chess_zobrist_keys.castle[i & -i]
+            ^ ((i & (i - 1)) ? chess_zobrist_keys.castle[i & (i - 1)] : 0);
+    }
+
+    for (i = CHESS_FILE_A; i <= CHESS_FILE_H; i++)
+        chess_zobrist_keys.ep[i] = next_key(&state);
+
+    chess_zobrist_keys.black_to_move = next_key(&state);
+}
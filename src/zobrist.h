@@ -0,0 +1,25 @@
+#ifndef CHESSLIB_ZOBRIST_H_
+#define CHESSLIB_ZOBRIST_H_
+
+#include <stdint.h>
+
+#include "chess.h"
+
+/* A 64-bit Zobrist key identifying a position */
+typedef uint64_t ChessHash;
+
+typedef struct
+{
+    ChessHash piece[14][64]; /* indexed by ChessPiece and ChessSquare */
+    ChessHash castle[16]; /* indexed by ChessCastleState */
+    ChessHash ep[8]; /* indexed by ChessFile */
+    ChessHash black_to_move;
+} ChessZobristKeys;
+
+/* The keys are drawn from a fixed seed, so a position hashes the same on
+ * every run and hashes may be stored. They are set up by chess_generate_init. */
+extern ChessZobristKeys chess_zobrist_keys;
+
+void chess_zobrist_init(void);
+
+#endif /* CHESSLIB_ZOBRIST_H_ */